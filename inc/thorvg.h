@@ -57,6 +57,7 @@ enum class TVG_EXPORT StrokeCap { Square = 0, Round, Butt };
 enum class TVG_EXPORT StrokeJoin { Bevel = 0, Round, Miter };
 enum class TVG_EXPORT FillSpread { Pad = 0, Reflect, Repeat };
 enum class TVG_EXPORT CanvasEngine { Sw = (1 << 1), Gl = (1 << 2)};
+enum class TVG_EXPORT CompositeMethod { None = 0, ClipPath };
 
 
 struct Point
@@ -91,6 +92,8 @@ public:
     Result translate(float x, float y) noexcept;
     Result transform(const Matrix& m) noexcept;
     Result bounds(float* x, float* y, float* w, float* h) const noexcept;
+    //GlCanvas clips with the stencil buffer, without one in its target the paint is drawn unclipped
+    Result composite(std::unique_ptr<Paint> target, CompositeMethod method) noexcept;
 
     _TVG_DECLARE_ACCESSOR();
     _TVG_DECLARE_PRIVATE(Paint);
@@ -235,6 +238,9 @@ public:
     Result fill(uint8_t r, uint8_t g, uint8_t b, uint8_t a) noexcept;
     Result fill(std::unique_ptr<Fill> f) noexcept;
 
+    //Anti-Aliasing, disabled for whole pixel drawings
+    Result antiAlias(bool enable) noexcept;
+
     //Getters
     uint32_t pathCommands(const PathCommand** cmds) const noexcept;
     uint32_t pathCoords(const Point** pts) const noexcept;
@@ -246,6 +252,7 @@ public:
     uint32_t strokeDash(const float** dashPattern) const noexcept;
     StrokeCap strokeCap() const noexcept;
     StrokeJoin strokeJoin() const noexcept;
+    bool antiAlias() const noexcept;
 
     static std::unique_ptr<Shape> gen() noexcept;
 
@@ -291,6 +298,9 @@ public:
 
     Result push(std::unique_ptr<Paint> paint) noexcept;
     Result reserve(uint32_t size) noexcept;
+    Result opacity(uint8_t o) noexcept;
+
+    uint8_t opacity() const noexcept;
 
     static std::unique_ptr<Scene> gen() noexcept;
 
@@ -313,7 +323,23 @@ public:
 
     enum Colorspace { ABGR8888 = 0, ARGB8888 };
 
+    struct Region
+    {
+        uint32_t x, y, w, h;
+    };
+
+    struct Stats
+    {
+        uint32_t gradientHits, gradientMisses, gradientTables;
+        uint32_t bandShoots;
+        uint32_t spansUsed, spansIdle, spansHighWater;
+    };
+
     Result target(uint32_t* buffer, uint32_t stride, uint32_t w, uint32_t h, Colorspace cs) noexcept;
+    uint32_t damage(const Region** regions) const noexcept;
+    Result trim() noexcept;
+    Result stats(Stats* stats) const noexcept;
+    Result gradientCache(uint32_t cnt) noexcept;
 
     static std::unique_ptr<SwCanvas> gen() noexcept;
 
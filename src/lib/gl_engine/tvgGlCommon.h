@@ -49,6 +49,7 @@
 
 
 class GlGeometry;
+struct GlClipPath;
 
 struct GlShape
 {
@@ -56,6 +57,8 @@ struct GlShape
   float viewHt;
   RenderUpdateFlag updateFlag;
   unique_ptr<GlGeometry> geometry;
+  vector<GlClipPath*> clips;    //clip paths of the shape
+  bool clipper = false;         //a shape of a clip path, it's never drawn
 };
 
 
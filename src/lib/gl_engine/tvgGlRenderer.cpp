@@ -106,6 +106,8 @@ bool GlRenderer::render(const Shape& shape, void* data)
 
     GL_CHECK(glViewport(0, 0, sdata->viewWd, sdata->viewHt));
 
+    if (!sdata->clips.empty()) drawClipPaths(*sdata);
+
     uint32_t primitiveCount = sdata->geometry->getPrimitiveCount();
     for (uint32_t i = 0; i < primitiveCount; ++i)
     {
@@ -117,15 +119,90 @@ bool GlRenderer::render(const Shape& shape, void* data)
         else if (flags & RenderUpdateFlag::Color)
         {
             shape.fill(&r, &g, &b, &a);
-            drawPrimitive(*sdata, r, g, b, a, i, RenderUpdateFlag::Color);
+            drawPrimitive(*sdata, r, g, b, (a * mOpacity) / 255, i, RenderUpdateFlag::Color);
         }
         if (flags & RenderUpdateFlag::Stroke)
         {
             shape.strokeColor(&r, &g, &b, &a);
-            drawPrimitive(*sdata, r, g, b, a, i, RenderUpdateFlag::Stroke);
+            drawPrimitive(*sdata, r, g, b, (a * mOpacity) / 255, i, RenderUpdateFlag::Stroke);
         }
     }
 
+    if (!sdata->clips.empty()) {
+        GL_CHECK(glDisable(GL_STENCIL_TEST));
+    }
+
+    return true;
+}
+
+
+bool GlRenderer::beginComposite(uint8_t opacity)
+{
+    /* There is no offscreen layer yet: the opacity is folded into the shapes of the composite,
+       so overlapping children show through each other. */
+    mOpacities.push_back(mOpacity);
+    mOpacity = (mOpacity * opacity) / 255;
+
+    return true;
+}
+
+
+bool GlRenderer::endComposite()
+{
+    if (mOpacities.empty()) return false;
+
+    mOpacity = mOpacities.back();
+    mOpacities.pop_back();
+
+    return true;
+}
+
+
+bool GlRenderer::beginClipPath()
+{
+    mClipFrames.emplace_back();
+
+    return true;
+}
+
+
+void* GlRenderer::endClipPath(void* data)
+{
+    if (mClipFrames.empty()) return data;
+
+    auto clipPath = static_cast<GlClipPath*>(data);
+    if (!clipPath) {
+        clipPath = new GlClipPath;
+        if (!clipPath) {
+            mClipFrames.pop_back();
+            return nullptr;
+        }
+    }
+
+    clipPath->shapes = move(mClipFrames.back());
+    mClipFrames.pop_back();
+    mClipPaths.push_back(clipPath);
+
+    return clipPath;
+}
+
+
+bool GlRenderer::popClipPath()
+{
+    if (mClipPaths.empty()) return false;
+
+    mClipPaths.pop_back();
+
+    return true;
+}
+
+
+bool GlRenderer::disposeClipPath(void* data)
+{
+    auto clipPath = static_cast<GlClipPath*>(data);
+    if (!clipPath) return true;
+
+    delete clipPath;
     return true;
 }
 
@@ -151,6 +228,18 @@ void* GlRenderer::prepare(const Shape& shape, void* data, TVG_UNUSED const Rende
 
     sdata->viewWd = static_cast<float>(surface.w);
     sdata->viewHt = static_cast<float>(surface.h);
+
+    //A shape of the clip path being collected, only its fill is traced into the stencil
+    if (!mClipFrames.empty()) {
+        sdata->clipper = true;
+        mClipFrames.back().push_back(sdata);
+        if (flags != RenderUpdateFlag::None) flags = static_cast<RenderUpdateFlag>(flags | RenderUpdateFlag::Color);
+    } else if (!sdata->clipper) {
+        sdata->clips = mClipPaths;
+    }
+
+    //The stroke color is a part of the stroke geometry here
+    if (flags & RenderUpdateFlag::StrokeColor) flags = static_cast<RenderUpdateFlag>(flags | RenderUpdateFlag::Stroke);
     sdata->updateFlag = flags;
 
     if (sdata->updateFlag == RenderUpdateFlag::None) return sdata;
@@ -163,7 +252,8 @@ void* GlRenderer::prepare(const Shape& shape, void* data, TVG_UNUSED const Rende
     shape.strokeColor(nullptr, nullptr, nullptr, &alphaS);
     auto strokeWd = shape.strokeWidth();
 
-    if ( ((sdata->updateFlag & RenderUpdateFlag::Gradient) == 0) &&
+    if ( !sdata->clipper &&
+         ((sdata->updateFlag & RenderUpdateFlag::Gradient) == 0) &&
          ((sdata->updateFlag & RenderUpdateFlag::Color) && alphaF == 0) &&
          ((sdata->updateFlag & RenderUpdateFlag::Stroke) && alphaS == 0) )
     {
@@ -295,7 +385,7 @@ void GlRenderer::drawPrimitive(GlShape& sdata, const Fill* fill, uint32_t primit
         rTask->setStopCount((int)stopCnt);
         for (uint32_t i = 0; i < stopCnt; ++i)
         {
-            rTask->setStopColor(i, stops[i].offset, stops[i].r, stops[i].g, stops[i].b, stops[i].a);
+            rTask->setStopColor(i, stops[i].offset, stops[i].r, stops[i].g, stops[i].b, (stops[i].a * mOpacity) / 255);
         }
 
         rTask->uploadValues();
@@ -304,3 +394,33 @@ void GlRenderer::drawPrimitive(GlShape& sdata, const Fill* fill, uint32_t primit
     }
 }
 
+
+void GlRenderer::drawClipPaths(GlShape& sdata)
+{
+    /* The stencil counts the clip paths covering each pixel, the shape is drawn where all of them do.
+       Without a stencil buffer the test always passes and the shape is left unclipped. */
+    GL_CHECK(glClearStencil(0));
+    GL_CHECK(glClear(GL_STENCIL_BUFFER_BIT));
+    GL_CHECK(glEnable(GL_STENCIL_TEST));
+    GL_CHECK(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
+    GL_CHECK(glStencilOp(GL_KEEP, GL_KEEP, GL_INCR));
+
+    uint32_t level = 0;
+    for (auto clipPath : sdata.clips) {
+        //Only the pixels inside the former clip paths step up, once however many shapes cover them
+        GL_CHECK(glStencilFunc(GL_EQUAL, level, 0xff));
+        for (auto clipper : clipPath->shapes) {
+            if (!clipper->geometry) continue;
+            auto primitiveCount = clipper->geometry->getPrimitiveCount();
+            for (uint32_t i = 0; i < primitiveCount; ++i) {
+                drawPrimitive(*clipper, 0, 0, 0, 0, i, RenderUpdateFlag::Color);
+            }
+        }
+        ++level;
+    }
+
+    GL_CHECK(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+    GL_CHECK(glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP));
+    GL_CHECK(glStencilFunc(GL_EQUAL, level, 0xff));
+}
+
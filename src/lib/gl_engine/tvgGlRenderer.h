@@ -27,6 +27,12 @@
 #include "tvgGlProgram.h"
 #include "tvgGlRenderTask.h"
 
+//Union of the shapes prepared between beginClipPath() and endClipPath()
+struct GlClipPath
+{
+    vector<GlShape*> shapes;
+};
+
 class GlRenderer : public RenderMethod
 {
 public:
@@ -36,6 +42,12 @@ public:
     bool dispose(const Shape& shape, void *data) override;
     bool preRender() override;
     bool render(const Shape& shape, void *data) override;
+    bool beginComposite(uint8_t opacity) override;
+    bool endComposite() override;
+    bool beginClipPath() override;
+    void* endClipPath(void* data) override;
+    bool popClipPath() override;
+    bool disposeClipPath(void* data) override;
     bool postRender() override;
     bool target(uint32_t* buffer, uint32_t stride, uint32_t w, uint32_t h);
     bool flush() override;
@@ -52,8 +64,13 @@ private:
     void initShaders();
     void drawPrimitive(GlShape& sdata, uint8_t r, uint8_t g, uint8_t b, uint8_t a, uint32_t primitiveIndex, RenderUpdateFlag flag);
     void drawPrimitive(GlShape& sdata, const Fill* fill, uint32_t primitiveIndex, RenderUpdateFlag flag);
+    void drawClipPaths(GlShape& sdata);
 
     vector<shared_ptr<GlRenderTask>>  mRenderTasks;
+    vector<uint8_t> mOpacities;     //opacities outside the open composites
+    uint8_t mOpacity = 255;         //product of the open composite opacities
+    vector<vector<GlShape*>> mClipFrames;   //shapes of the clip paths being collected
+    vector<GlClipPath*> mClipPaths;         //clip paths applied to the prepared shapes
 };
 
 #endif /* _TVG_GL_RENDERER_H_ */
@@ -24,8 +24,13 @@
 
 #include "tvgCommon.h"
 
-#ifdef THORVG_AVX_VECTOR_SUPPORT
+//No build flag is needed: the kernels are built per function and the host cpu is probed at runtime. See rasterInit()
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(THORVG_NO_VECTOR_SUPPORT)
+    #define SW_CPU_DISPATCH
     #include <immintrin.h>
+    #define SW_TARGET_SSE2 __attribute__ ((target ("sse2")))
+    #define SW_TARGET_SSE41 __attribute__ ((target ("sse4.1")))
+    #define SW_TARGET_AVX2 __attribute__ ((target ("avx2")))
 #endif
 
 #if 0
@@ -46,6 +51,7 @@ static double timeStamp()
 #define SW_ANGLE_2PI (SW_ANGLE_PI << 1)
 #define SW_ANGLE_PI2 (SW_ANGLE_PI >> 1)
 #define SW_ANGLE_PI4 (SW_ANGLE_PI >> 2)
+#define SW_OUTLINE_COORD_MAX (1 << 29)    //26.6 coordinates of the outlines, the differences still fit in 32 bits
 
 using SwCoord = signed long;
 using SwFixed = signed long long;
@@ -96,17 +102,33 @@ struct SwSize
     SwCoord w, h;
 };
 
+//Compact point of the outlines, it's loaded into a SwPoint for the math
+struct SwOutlinePoint
+{
+    int32_t x, y;
+
+    SwOutlinePoint& operator=(const SwPoint& rhs) {
+        x = static_cast<int32_t>(rhs.x < -SW_OUTLINE_COORD_MAX ? -SW_OUTLINE_COORD_MAX : (rhs.x > SW_OUTLINE_COORD_MAX ? SW_OUTLINE_COORD_MAX : rhs.x));
+        y = static_cast<int32_t>(rhs.y < -SW_OUTLINE_COORD_MAX ? -SW_OUTLINE_COORD_MAX : (rhs.y > SW_OUTLINE_COORD_MAX ? SW_OUTLINE_COORD_MAX : rhs.y));
+        return *this;
+    }
+
+    operator SwPoint() const {
+        return {x, y};
+    }
+};
+
 struct SwOutline
 {
-    uint32_t*     cntrs;            //the contour end points
-    uint32_t      cntrsCnt;         //number of contours in glyph
-    uint32_t      reservedCntrsCnt;
-    SwPoint*      pts;              //the outline's points
-    uint32_t      ptsCnt;           //number of points in the glyph
-    uint32_t      reservedPtsCnt;
-    uint8_t*      types;            //curve type
-    uint8_t       fillMode;         //outline fill mode
-    bool          opened;           //opened path?
+    uint32_t*       cntrs;            //the contour end points
+    uint32_t        cntrsCnt;         //number of contours in glyph
+    uint32_t        reservedCntrsCnt;
+    SwOutlinePoint* pts;              //the outline's points
+    uint32_t        ptsCnt;           //number of points in the glyph
+    uint32_t        reservedPtsCnt;
+    uint8_t*        types;            //curve type
+    uint8_t         fillMode;         //outline fill mode
+    bool            opened;           //opened path?
 };
 
 struct SwSpan
@@ -116,11 +138,20 @@ struct SwSpan
     uint8_t coverage;
 };
 
+struct SwSpanPool;
+
 struct SwRleData
 {
     SwSpan *spans;
     uint32_t alloc;
     uint32_t size;
+    SwSpanPool* pool;       //owner of the spans memory, nullptr for the heap
+
+    //Optional row index: spans of the row y are [rows[y - yMin], rows[y - yMin + 1])
+    uint32_t* rows;
+    SwCoord yMin;
+    uint32_t rowCnt;
+    uint32_t rowAlloc;
 };
 
 struct SwBBox
@@ -155,6 +186,7 @@ struct SwStroke
     StrokeJoin joinSaved;
 
     SwStrokeBorder borders[2];
+    SwOutline outline;      //exported borders, the memory is kept for the next update
 
     float sx, sy;
 
@@ -165,16 +197,20 @@ struct SwStroke
 
 struct SwDashStroke
 {
-    SwOutline* outline;
-    int32_t curLen;
-    int32_t curIdx;
+    SwStroke* stroke;
+    const Matrix* transform;
+    float curLen;
+    uint32_t curIdx;
     Point ptStart;
     Point ptCur;
-    float* pattern;
+    const float* pattern;
     uint32_t cnt;
     bool curOpGap;
+    bool drawing;     //a dash is being fed into the stroker
 };
 
+struct SwColorTable;
+
 struct SwFill
 {
     struct SwLinear {
@@ -194,13 +230,23 @@ struct SwFill
         SwRadial radial;
     };
 
-    uint32_t* ctable;
+    uint32_t* ctable;               //points into the shared color table
+    SwColorTable* colorTable;
     FillSpread spread;
     float sx, sy;
 
     bool translucent;
 };
 
+//Axis aligned rectangle of the elliptic or the cut corners
+struct SwRoundRect
+{
+    float x1, y1, x2, y2;
+    float rx, ry;
+    float k;        //handle length of the corner cubics, in the radii
+    bool bevel;     //straight corners
+};
+
 struct SwShape
 {
     SwOutline*   outline = nullptr;
@@ -208,9 +254,12 @@ struct SwShape
     SwFill*      fill = nullptr;
     SwRleData*   rle = nullptr;
     SwRleData*   strokeRle = nullptr;
+    SwSpanPool*  pool = nullptr;    //spans memory of the rle data
     SwBBox       bbox;
+    SwRoundRect  roundRect; //geometry of the round fast track
 
     bool         rect;   //Fast Track: Othogonal rectangle?
+    bool         round;  //Fast Track: Axis aligned rectangle, rounded rectangle or ellipse?
 };
 
 struct SwCompositor
@@ -224,6 +273,22 @@ struct SwSurface : Surface
     SwCompositor comp;
 };
 
+enum SwCpu {SW_CPU_C = 0, SW_CPU_SSE2, SW_CPU_SSE41, SW_CPU_AVX2};
+
+//Hot kernels, picked once for the host cpu by rasterInit()
+struct SwKernels
+{
+    void (*rgba32)(uint32_t *dst, uint32_t val, uint32_t offset, int32_t len);
+    void (*translucentRgba32)(uint32_t *dst, uint32_t val, uint32_t ialpha, uint32_t offset, int32_t len);
+    //gradient spans, indexed by FillSpread
+    void (*linear[3])(const uint32_t* ctable, uint32_t* dst, int32_t t, int32_t inc, uint32_t len);
+    void (*radial[3])(const uint32_t* ctable, uint32_t* dst, float det, float detDelta, float detDelta2, uint32_t len);
+    //path points to the outline, indexed by the kind of the transform: identity, translate, scale, affine
+    void (*transform[4])(const Point* pts, SwOutlinePoint* dst, uint32_t cnt, const Matrix* m);
+};
+
+extern SwKernels swKernels;
+
 static inline SwCoord TO_SWCOORD(float val)
 {
     return SwCoord(val * 64);
@@ -266,10 +331,13 @@ SwFixed mathLength(SwPoint& pt);
 bool mathSmallCubic(SwPoint* base, SwFixed& angleIn, SwFixed& angleMid, SwFixed& angleOut);
 SwFixed mathMean(SwFixed angle1, SwFixed angle2);
 
+void shapeInit(SwCpu cpu);
 void shapeReset(SwShape* shape);
 bool shapeGenOutline(SwShape* shape, const Shape* sdata, const Matrix* transform);
 bool shapePrepare(SwShape* shape, const Shape* sdata, const SwSize& clip, const Matrix* transform);
-bool shapeGenRle(SwShape* shape, const Shape* sdata, const SwSize& clip, bool antiAlias);
+bool shapeGenRle(SwShape* shape, const Shape* sdata, const SwSize& clip, bool antiAlias, bool hasComposite);
+bool shapeTranslate(SwShape* shape, SwCoord dx, SwCoord dy, const SwSize& clip);
+void shapeResetOutline(SwShape* shape);
 void shapeDelOutline(SwShape* shape);
 void shapeResetStroke(SwShape* shape, const Shape* sdata, const Matrix* transform);
 bool shapeGenStrokeRle(SwShape* shape, const Shape* sdata, const Matrix* transform, const SwSize& clip);
@@ -281,48 +349,64 @@ void shapeDelFill(SwShape* shape);
 
 void strokeReset(SwStroke* stroke, const Shape* shape, const Matrix* transform);
 bool strokeParseOutline(SwStroke* stroke, const SwOutline& outline);
+void strokeBeginPath(SwStroke* stroke, const SwPoint& to, bool opened);
+void strokeLineTo(SwStroke* stroke, const SwPoint& to);
+void strokeCubicTo(SwStroke* stroke, const SwPoint& ctrl1, const SwPoint& ctrl2, const SwPoint& to);
+void strokeEndPath(SwStroke* stroke);
+void strokeDot(SwStroke* stroke, const SwPoint& center, SwFixed angle);
 SwOutline* strokeExportOutline(SwStroke* stroke);
 void strokeFree(SwStroke* stroke);
 
 bool fillGenColorTable(SwFill* fill, const Fill* fdata, const Matrix* transform, SwSurface* surface, bool ctable);
 void fillReset(SwFill* fill);
 void fillFree(SwFill* fill);
+void fillInit(SwCpu cpu);
+void fillTerm();
+void fillCacheLimit(uint32_t cnt);
+void fillCacheStats(uint32_t* hits, uint32_t* misses, uint32_t* tables);
 void fillFetchLinear(const SwFill* fill, uint32_t* dst, uint32_t y, uint32_t x, uint32_t offset, uint32_t len);
 void fillFetchRadial(const SwFill* fill, uint32_t* dst, uint32_t y, uint32_t x, uint32_t len);
 
-SwRleData* rleRender(const SwOutline* outline, const SwBBox& bbox, const SwSize& clip, bool antiAlias);
+SwRleData* rleRender(SwRleData* rle, SwSpanPool* pool, const SwOutline* outline, const SwBBox& bbox, const SwSize& clip, bool antiAlias, bool accumulate);
+SwRleData* rleHairline(SwRleData* rle, SwSpanPool* pool, const SwOutline* outline, const SwBBox& bbox, const SwSize& clip, float width, StrokeCap cap);
+SwRleData* rleRoundRect(SwRleData* rle, SwSpanPool* pool, const SwRoundRect& outer, const SwRoundRect* inner, const SwBBox& bbox, const SwSize& clip, bool antiAlias);
+bool rleSlice(const SwRleData* rle, SwCoord min, SwCoord max, SwRleData& out);
+bool rleClipRect(const SwRleData* rle, const SwBBox& clip, SwRleData& out);
+bool rleBBox(const SwRleData* rle, SwBBox& bbox);
+bool rleIntersect(const SwRleData* lhs, const SwRleData* rhs, SwRleData* out);
+bool rleUnion(const SwRleData* lhs, const SwRleData* rhs, SwRleData* out);
+bool rleSubtract(const SwRleData* lhs, const SwRleData* rhs, SwRleData* out);
+bool rleClipPath(SwRleData* rle, const SwRleData* clip);
+bool rleAddPath(SwRleData* rle, const SwRleData* path);
+bool rleTranslate(SwRleData* rle, SwCoord dx, SwCoord dy, const SwSize& clip);
+void rleReset(SwRleData* rle);
 void rleFree(SwRleData* rle);
-
+SwSpanPool* rlePoolInit();
+void rlePoolTrim(SwSpanPool* pool);
+void rlePoolStats(SwSpanPool* pool, uint32_t* used, uint32_t* idle, uint32_t* highWater);
+void rlePoolTerm(SwSpanPool* pool);
+uint32_t rleBandShoots();
+void rleTerm();
+
+bool rasterInit();
 bool rasterCompositor(SwSurface* surface);
 bool rasterGradientShape(SwSurface* surface, SwShape* shape, unsigned id);
-bool rasterSolidShape(SwSurface* surface, SwShape* shape, uint8_t r, uint8_t g, uint8_t b, uint8_t a);
-bool rasterStroke(SwSurface* surface, SwShape* shape, uint8_t r, uint8_t g, uint8_t b, uint8_t a);
+uint32_t rasterColor(SwSurface* surface, uint8_t r, uint8_t g, uint8_t b, uint8_t a);
+bool rasterSolidShape(SwSurface* surface, SwShape* shape, uint32_t color, uint8_t a);
+bool rasterStroke(SwSurface* surface, SwShape* shape, uint32_t color, uint8_t a);
+bool rasterComposite(SwSurface* surface, const uint32_t* buffer, const SwBBox& region, uint8_t opacity);
 bool rasterClear(SwSurface* surface);
 
 
 static inline void rasterRGBA32(uint32_t *dst, uint32_t val, uint32_t offset, int32_t len)
 {
-#ifdef THORVG_AVX_VECTOR_SUPPORT
-    int32_t align = (8 - (offset % 8)) % 8;
-    //Vectorization
-    auto avxDst = (__m256i*)(dst + offset + align);
-    int32_t i = (len - align);
-    for (;i > 7; i -= 8, ++avxDst) {
-       *avxDst = _mm256_set1_epi32(val);
-    }
-    //Alignment
-    if (align > 0) {
-        if (align > len) align -= (align - len);
-        auto tmp = dst + offset;
-        for (; align > 0; --align, ++tmp) *tmp = val;
-    }
-    //Pack Leftovers
-    dst += offset + (len - i);
-    while (i-- > 0) *(dst++) = val;
-#else
-    dst += offset;
-    while (len--) *dst++ = val;
-#endif
+    swKernels.rgba32(dst, val, offset, len);
+}
+
+
+static inline void rasterTranslucentRGBA32(uint32_t *dst, uint32_t val, uint32_t ialpha, uint32_t offset, int32_t len)
+{
+    swKernels.translucentRgba32(dst, val, ialpha, offset, len);
 }
 
 #endif /* _TVG_SW_COMMON_H_ */
@@ -19,6 +19,8 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
  * SOFTWARE.
  */
+#include <mutex>
+#include <unordered_map>
 #include "tvgSwCommon.h"
 
 
@@ -31,20 +33,113 @@
 #define FIXPT_SIZE (1<<FIXPT_BITS)
 
 
-static bool _updateColorTable(SwFill* fill, const Fill* fdata, SwSurface* surface)
+//Color tables are shared between the fills of the same color stops
+struct SwColorTable
+{
+    uint32_t table[GRADIENT_STOP_SIZE];
+    Fill::ColorStop* stops;
+    uint32_t cnt;
+    uint32_t cs;
+    uint32_t hash;
+    uint32_t refCnt;
+    SwColorTable* prev;             //idle list, most recently released first
+    SwColorTable* next;
+    bool translucent;
+};
+
+
+struct SwColorTableCache
+{
+    unordered_multimap<uint32_t, SwColorTable*> tables;
+    SwColorTable* idleHead = nullptr;
+    SwColorTable* idleTail = nullptr;
+    uint32_t idleCnt = 0;
+    uint32_t limit = 64;            //max unreferenced tables kept alive
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    mutex mtx;
+};
+
+static SwColorTableCache cache;
+
+
+static uint32_t _hash(const Fill::ColorStop* colors, uint32_t cnt, uint32_t cs)
 {
-    if (!fill->ctable) {
-        fill->ctable = static_cast<uint32_t*>(malloc(GRADIENT_STOP_SIZE * sizeof(uint32_t)));
-        if (!fill->ctable) return false;
+    //FNV-1a
+    uint32_t hash = 2166136261u;
+    auto bytes = reinterpret_cast<const uint8_t*>(colors);
+    for (uint32_t i = 0; i < cnt * sizeof(Fill::ColorStop); ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
     }
+    return (hash ^ cs) * 16777619u;
+}
 
-    const Fill::ColorStop* colors;
-    auto cnt = fdata->colorStops(&colors);
-    if (cnt == 0 || !colors) return false;
 
+static void _idleRemove(SwColorTable* ctable)
+{
+    if (ctable->prev) ctable->prev->next = ctable->next;
+    else cache.idleHead = ctable->next;
+    if (ctable->next) ctable->next->prev = ctable->prev;
+    else cache.idleTail = ctable->prev;
+    ctable->prev = ctable->next = nullptr;
+    --cache.idleCnt;
+}
+
+
+static void _idlePush(SwColorTable* ctable)
+{
+    ctable->prev = nullptr;
+    ctable->next = cache.idleHead;
+    if (cache.idleHead) cache.idleHead->prev = ctable;
+    else cache.idleTail = ctable;
+    cache.idleHead = ctable;
+    ++cache.idleCnt;
+}
+
+
+static void _delColorTable(SwColorTable* ctable)
+{
+    auto range = cache.tables.equal_range(ctable->hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == ctable) {
+            cache.tables.erase(it);
+            break;
+        }
+    }
+    free(ctable->stops);
+    free(ctable);
+}
+
+
+//Drop the least recently released tables until the cache fits its limit
+static void _trimColorTables(uint32_t limit)
+{
+    while (cache.idleCnt > limit) {
+        auto ctable = cache.idleTail;
+        _idleRemove(ctable);
+        _delColorTable(ctable);
+    }
+}
+
+
+static SwColorTable* _findColorTable(const Fill::ColorStop* colors, uint32_t cnt, uint32_t cs, uint32_t hash)
+{
+    auto range = cache.tables.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        auto ctable = it->second;
+        if (ctable->cnt != cnt || ctable->cs != cs) continue;
+        if (memcmp(ctable->stops, colors, cnt * sizeof(Fill::ColorStop))) continue;
+        return ctable;
+    }
+    return nullptr;
+}
+
+
+static void _buildColorTable(SwColorTable* ctable, const Fill::ColorStop* colors, uint32_t cnt, SwSurface* surface)
+{
     auto pColors = colors;
 
-    if (pColors->a < 255) fill->translucent = true;
+    if (pColors->a < 255) ctable->translucent = true;
 
     auto r = ALPHA_MULTIPLY(pColors->r, pColors->a);
     auto g = ALPHA_MULTIPLY(pColors->g, pColors->a);
@@ -55,10 +150,10 @@ static bool _updateColorTable(SwFill* fill, const Fill* fdata, SwSurface* surfac
     auto pos = 1.5f * inc;
     uint32_t i = 0;
 
-    fill->ctable[i++] = rgba;
+    ctable->table[i++] = rgba;
 
     while (pos <= pColors->offset) {
-        fill->ctable[i] = fill->ctable[i - 1];
+        ctable->table[i] = ctable->table[i - 1];
         ++i;
         pos += inc;
     }
@@ -67,7 +162,7 @@ static bool _updateColorTable(SwFill* fill, const Fill* fdata, SwSurface* surfac
         auto curr = colors + j;
         auto next = curr + 1;
         auto delta = 1.0f / (next->offset - curr->offset);
-        if (next->a < 255) fill->translucent = true;
+        if (next->a < 255) ctable->translucent = true;
 
         auto r = ALPHA_MULTIPLY(next->r, next->a);
         auto g = ALPHA_MULTIPLY(next->g, next->a);
@@ -79,7 +174,7 @@ static bool _updateColorTable(SwFill* fill, const Fill* fdata, SwSurface* surfac
             auto t = (pos - curr->offset) * delta;
             auto dist = static_cast<int32_t>(256 * t);
             auto dist2 = 256 - dist;
-            fill->ctable[i] = COLOR_INTERPOLATE(rgba, dist2, rgba2, dist);
+            ctable->table[i] = COLOR_INTERPOLATE(rgba, dist2, rgba2, dist);
             ++i;
             pos += inc;
         }
@@ -87,10 +182,84 @@ static bool _updateColorTable(SwFill* fill, const Fill* fdata, SwSurface* surfac
     }
 
     for (; i < GRADIENT_STOP_SIZE; ++i)
-        fill->ctable[i] = rgba;
+        ctable->table[i] = rgba;
 
     //Make sure the lat color stop is represented at the end of the table
-    fill->ctable[GRADIENT_STOP_SIZE - 1] = rgba;
+    ctable->table[GRADIENT_STOP_SIZE - 1] = rgba;
+}
+
+
+static void _releaseColorTable(SwFill* fill)
+{
+    if (!fill->colorTable) return;
+
+    {
+        unique_lock<mutex> lock{cache.mtx};
+        auto ctable = fill->colorTable;
+        if (--ctable->refCnt == 0) {
+            _idlePush(ctable);
+            _trimColorTables(cache.limit);
+        }
+    }
+    fill->colorTable = nullptr;
+    fill->ctable = nullptr;
+}
+
+
+static bool _updateColorTable(SwFill* fill, const Fill* fdata, SwSurface* surface)
+{
+    const Fill::ColorStop* colors;
+    auto cnt = fdata->colorStops(&colors);
+    if (cnt == 0 || !colors) return false;
+
+    auto hash = _hash(colors, cnt, surface->cs);
+
+    _releaseColorTable(fill);
+
+    unique_lock<mutex> lock{cache.mtx};
+
+    auto ctable = _findColorTable(colors, cnt, surface->cs, hash);
+
+    if (ctable) {
+        ++cache.hits;
+        if (ctable->refCnt == 0) _idleRemove(ctable);
+    } else {
+        ++cache.misses;
+        //The table is built outside of the lock, other tasks may look up meanwhile
+        lock.unlock();
+
+        ctable = static_cast<SwColorTable*>(calloc(1, sizeof(SwColorTable)));
+        if (!ctable) return false;
+        ctable->stops = static_cast<Fill::ColorStop*>(malloc(cnt * sizeof(Fill::ColorStop)));
+        if (!ctable->stops) {
+            free(ctable);
+            return false;
+        }
+        memcpy(ctable->stops, colors, cnt * sizeof(Fill::ColorStop));
+        ctable->cnt = cnt;
+        ctable->cs = surface->cs;
+        ctable->hash = hash;
+        _buildColorTable(ctable, colors, cnt, surface);
+
+        lock.lock();
+
+        //Someone else might have registered the same table in the meantime
+        auto dup = _findColorTable(colors, cnt, surface->cs, hash);
+        if (dup) {
+            free(ctable->stops);
+            free(ctable);
+            ctable = dup;
+            if (ctable->refCnt == 0) _idleRemove(ctable);
+        } else {
+            cache.tables.emplace(hash, ctable);
+        }
+    }
+
+    ++ctable->refCnt;
+
+    fill->colorTable = ctable;
+    fill->ctable = ctable->table;
+    fill->translucent = ctable->translucent;
 
     return true;
 }
@@ -164,49 +333,249 @@ bool _prepareRadial(SwFill* fill, const RadialGradient* radial, const Matrix* tr
 }
 
 
-static inline uint32_t _clamp(const SwFill* fill, int32_t pos)
+//Gradient stop index of the position, specialized by the spread mode
+template<FillSpread spread>
+static inline int32_t _clamp(int32_t pos)
 {
-    switch (fill->spread) {
-        case FillSpread::Pad: {
-            if (pos >= GRADIENT_STOP_SIZE) pos = GRADIENT_STOP_SIZE - 1;
-            else if (pos < 0) pos = 0;
-            break;
-        }
-        case FillSpread::Repeat: {
-            if (pos < 0) pos = GRADIENT_STOP_SIZE + pos;
-            pos = pos % GRADIENT_STOP_SIZE;
-            break;
-        }
-        case FillSpread::Reflect: {
-            auto limit = GRADIENT_STOP_SIZE * 2;
-            pos = pos % limit;
-            if (pos < 0) pos = limit + pos;
-            if (pos >= GRADIENT_STOP_SIZE) pos = (limit - pos - 1);
-            break;
-        }
+    if (spread == FillSpread::Pad) {
+        if (pos >= GRADIENT_STOP_SIZE) return GRADIENT_STOP_SIZE - 1;
+        if (pos < 0) return 0;
+        return pos;
     }
+    if (spread == FillSpread::Repeat) return pos & (GRADIENT_STOP_SIZE - 1);
+
+    //Reflect
+    pos &= (GRADIENT_STOP_SIZE * 2 - 1);
+    if (pos >= GRADIENT_STOP_SIZE) pos = (GRADIENT_STOP_SIZE * 2 - 1) - pos;
     return pos;
 }
 
 
-static inline uint32_t _fixedPixel(const SwFill* fill, int32_t pos)
+static inline int32_t _clamp(const SwFill* fill, int32_t pos)
+{
+    switch (fill->spread) {
+        case FillSpread::Pad: return _clamp<FillSpread::Pad>(pos);
+        case FillSpread::Repeat: return _clamp<FillSpread::Repeat>(pos);
+        case FillSpread::Reflect: return _clamp<FillSpread::Reflect>(pos);
+    }
+    return 0;
+}
+
+
+static inline int32_t _fixedIndex(int32_t pos)
+{
+    return (pos + (FIXPT_SIZE / 2)) >> FIXPT_BITS;
+}
+
+
+static inline int32_t _index(float pos)
+{
+    return static_cast<int32_t>(pos * (GRADIENT_STOP_SIZE - 1) + 0.5f);
+}
+
+
+/* det(n) = det + n * detDelta + (n * (n - 1) / 2) * detDelta2,
+   evaluated directly so that every lane of the vector kernels agrees with the scalar one. */
+static inline float _radialDet(float n, float det, float detDelta, float detDelta2)
 {
-    int32_t i = (pos + (FIXPT_SIZE / 2)) >> FIXPT_BITS;
-    return fill->ctable[_clamp(fill, i)];
+    return det + n * detDelta + (n * (n - 1.0f) * 0.5f) * detDelta2;
 }
 
 
-static inline uint32_t _pixel(const SwFill* fill, float pos)
+template<FillSpread spread>
+static void _linearC(const uint32_t* ctable, uint32_t* dst, int32_t t, int32_t inc, uint32_t len)
 {
-    auto i = static_cast<int32_t>(pos * (GRADIENT_STOP_SIZE - 1) + 0.5f);
-    return fill->ctable[_clamp(fill, i)];
+    for (; len > 0; --len, t += inc) {
+        *dst++ = ctable[_clamp<spread>(_fixedIndex(t))];
+    }
+}
+
+
+template<FillSpread spread>
+static void _radialC(const uint32_t* ctable, uint32_t* dst, float det, float detDelta, float detDelta2, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; ++i) {
+        *dst++ = ctable[_clamp<spread>(_index(sqrtf(_radialDet(i, det, detDelta, detDelta2))))];
+    }
+}
+
+
+template<FillSpread spread>
+static void _linearFloat(const uint32_t* ctable, uint32_t* dst, float t, float inc, uint32_t len)
+{
+    for (; len > 0; --len, t += inc) {
+        *dst++ = ctable[_clamp<spread>(_index(t / GRADIENT_STOP_SIZE))];
+    }
+}
+
+
+#ifdef SW_CPU_DISPATCH
+
+template<FillSpread spread>
+SW_TARGET_SSE41 static inline __m128i _clampSse41(__m128i pos)
+{
+    if (spread == FillSpread::Pad) {
+        return _mm_min_epi32(_mm_max_epi32(pos, _mm_setzero_si128()), _mm_set1_epi32(GRADIENT_STOP_SIZE - 1));
+    }
+    if (spread == FillSpread::Repeat) return _mm_and_si128(pos, _mm_set1_epi32(GRADIENT_STOP_SIZE - 1));
+
+    //Reflect: min(pos, limit - pos) folds the upper half back
+    auto limit = _mm_set1_epi32(GRADIENT_STOP_SIZE * 2 - 1);
+    pos = _mm_and_si128(pos, limit);
+    return _mm_min_epi32(pos, _mm_sub_epi32(limit, pos));
 }
 
 
+SW_TARGET_SSE41 static inline void _lookupSse41(const uint32_t* ctable, uint32_t* dst, __m128i idx)
+{
+    //No gather instruction: pick the 4 colors one by one
+    dst[0] = ctable[_mm_cvtsi128_si32(idx)];
+    dst[1] = ctable[_mm_extract_epi32(idx, 1)];
+    dst[2] = ctable[_mm_extract_epi32(idx, 2)];
+    dst[3] = ctable[_mm_extract_epi32(idx, 3)];
+}
+
+
+template<FillSpread spread>
+SW_TARGET_SSE41 static void _linearSse41(const uint32_t* ctable, uint32_t* dst, int32_t t, int32_t inc, uint32_t len)
+{
+    auto sseT = _mm_add_epi32(_mm_set1_epi32(t), _mm_mullo_epi32(_mm_set1_epi32(inc), _mm_setr_epi32(0, 1, 2, 3)));
+    auto sseInc = _mm_set1_epi32(inc * 4);
+    auto sseHalf = _mm_set1_epi32(FIXPT_SIZE / 2);
+
+    for (; len > 3; len -= 4, dst += 4, t += inc * 4) {
+        auto idx = _mm_srai_epi32(_mm_add_epi32(sseT, sseHalf), FIXPT_BITS);
+        _lookupSse41(ctable, dst, _clampSse41<spread>(idx));
+        sseT = _mm_add_epi32(sseT, sseInc);
+    }
+    //Pack Leftovers
+    _linearC<spread>(ctable, dst, t, inc, len);
+}
+
+
+template<FillSpread spread>
+SW_TARGET_SSE41 static void _radialSse41(const uint32_t* ctable, uint32_t* dst, float det, float detDelta, float detDelta2, uint32_t len)
+{
+    auto sseN = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    auto sseStep = _mm_set1_ps(4.0f);
+    auto sseDet = _mm_set1_ps(det);
+    auto sseDelta = _mm_set1_ps(detDelta);
+    auto sseHalfDelta2 = _mm_set1_ps(detDelta2 * 0.5f);
+    auto sseOne = _mm_set1_ps(1.0f);
+    auto sseSize = _mm_set1_ps(GRADIENT_STOP_SIZE - 1);
+    auto sseHalf = _mm_set1_ps(0.5f);
+    uint32_t i = 0;
+
+    for (; i + 3 < len; i += 4, dst += 4) {
+        auto n2 = _mm_mul_ps(_mm_mul_ps(sseN, _mm_sub_ps(sseN, sseOne)), sseHalfDelta2);
+        auto d = _mm_add_ps(_mm_add_ps(sseDet, _mm_mul_ps(sseN, sseDelta)), n2);
+        auto pos = _mm_add_ps(_mm_mul_ps(_mm_sqrt_ps(d), sseSize), sseHalf);
+        _lookupSse41(ctable, dst, _clampSse41<spread>(_mm_cvttps_epi32(pos)));
+        sseN = _mm_add_ps(sseN, sseStep);
+    }
+    //Pack Leftovers
+    for (; i < len; ++i) {
+        *dst++ = ctable[_clamp<spread>(_index(sqrtf(_radialDet(i, det, detDelta, detDelta2))))];
+    }
+}
+
+
+template<FillSpread spread>
+SW_TARGET_AVX2 static inline __m256i _clampAvx2(__m256i pos)
+{
+    if (spread == FillSpread::Pad) {
+        return _mm256_min_epi32(_mm256_max_epi32(pos, _mm256_setzero_si256()), _mm256_set1_epi32(GRADIENT_STOP_SIZE - 1));
+    }
+    if (spread == FillSpread::Repeat) return _mm256_and_si256(pos, _mm256_set1_epi32(GRADIENT_STOP_SIZE - 1));
+
+    //Reflect: min(pos, limit - pos) folds the upper half back
+    auto limit = _mm256_set1_epi32(GRADIENT_STOP_SIZE * 2 - 1);
+    pos = _mm256_and_si256(pos, limit);
+    return _mm256_min_epi32(pos, _mm256_sub_epi32(limit, pos));
+}
+
+
+template<FillSpread spread>
+SW_TARGET_AVX2 static void _linearAvx2(const uint32_t* ctable, uint32_t* dst, int32_t t, int32_t inc, uint32_t len)
+{
+    auto avxT = _mm256_add_epi32(_mm256_set1_epi32(t), _mm256_mullo_epi32(_mm256_set1_epi32(inc), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+    auto avxInc = _mm256_set1_epi32(inc * 8);
+    auto avxHalf = _mm256_set1_epi32(FIXPT_SIZE / 2);
+
+    for (; len > 7; len -= 8, dst += 8, t += inc * 8) {
+        auto idx = _clampAvx2<spread>(_mm256_srai_epi32(_mm256_add_epi32(avxT, avxHalf), FIXPT_BITS));
+        _mm256_storeu_si256((__m256i*)dst, _mm256_i32gather_epi32((const int*)ctable, idx, 4));
+        avxT = _mm256_add_epi32(avxT, avxInc);
+    }
+    //Pack Leftovers
+    _linearC<spread>(ctable, dst, t, inc, len);
+}
+
+
+template<FillSpread spread>
+SW_TARGET_AVX2 static void _radialAvx2(const uint32_t* ctable, uint32_t* dst, float det, float detDelta, float detDelta2, uint32_t len)
+{
+    auto avxN = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    auto avxStep = _mm256_set1_ps(8.0f);
+    auto avxDet = _mm256_set1_ps(det);
+    auto avxDelta = _mm256_set1_ps(detDelta);
+    auto avxHalfDelta2 = _mm256_set1_ps(detDelta2 * 0.5f);
+    auto avxOne = _mm256_set1_ps(1.0f);
+    auto avxSize = _mm256_set1_ps(GRADIENT_STOP_SIZE - 1);
+    auto avxHalf = _mm256_set1_ps(0.5f);
+    uint32_t i = 0;
+
+    for (; i + 7 < len; i += 8, dst += 8) {
+        auto n2 = _mm256_mul_ps(_mm256_mul_ps(avxN, _mm256_sub_ps(avxN, avxOne)), avxHalfDelta2);
+        auto d = _mm256_add_ps(_mm256_add_ps(avxDet, _mm256_mul_ps(avxN, avxDelta)), n2);
+        auto pos = _mm256_add_ps(_mm256_mul_ps(_mm256_sqrt_ps(d), avxSize), avxHalf);
+        auto idx = _clampAvx2<spread>(_mm256_cvttps_epi32(pos));
+        _mm256_storeu_si256((__m256i*)dst, _mm256_i32gather_epi32((const int*)ctable, idx, 4));
+        avxN = _mm256_add_ps(avxN, avxStep);
+    }
+    //Pack Leftovers
+    for (; i < len; ++i) {
+        *dst++ = ctable[_clamp<spread>(_index(sqrtf(_radialDet(i, det, detDelta, detDelta2))))];
+    }
+}
+
+#endif
+
+
 /************************************************************************/
 /* External Class Implementation                                        */
 /************************************************************************/
 
+void fillInit(SwCpu cpu)
+{
+    //Indexed by FillSpread: Pad, Reflect, Repeat
+    swKernels.linear[0] = _linearC<FillSpread::Pad>;
+    swKernels.linear[1] = _linearC<FillSpread::Reflect>;
+    swKernels.linear[2] = _linearC<FillSpread::Repeat>;
+    swKernels.radial[0] = _radialC<FillSpread::Pad>;
+    swKernels.radial[1] = _radialC<FillSpread::Reflect>;
+    swKernels.radial[2] = _radialC<FillSpread::Repeat>;
+
+#ifdef SW_CPU_DISPATCH
+    if (cpu == SW_CPU_AVX2) {
+        swKernels.linear[0] = _linearAvx2<FillSpread::Pad>;
+        swKernels.linear[1] = _linearAvx2<FillSpread::Reflect>;
+        swKernels.linear[2] = _linearAvx2<FillSpread::Repeat>;
+        swKernels.radial[0] = _radialAvx2<FillSpread::Pad>;
+        swKernels.radial[1] = _radialAvx2<FillSpread::Reflect>;
+        swKernels.radial[2] = _radialAvx2<FillSpread::Repeat>;
+    } else if (cpu == SW_CPU_SSE41) {
+        swKernels.linear[0] = _linearSse41<FillSpread::Pad>;
+        swKernels.linear[1] = _linearSse41<FillSpread::Reflect>;
+        swKernels.linear[2] = _linearSse41<FillSpread::Repeat>;
+        swKernels.radial[0] = _radialSse41<FillSpread::Pad>;
+        swKernels.radial[1] = _radialSse41<FillSpread::Reflect>;
+        swKernels.radial[2] = _radialSse41<FillSpread::Repeat>;
+    }
+#endif
+}
+
+
 void fillFetchRadial(const SwFill* fill, uint32_t* dst, uint32_t y, uint32_t x, uint32_t len)
 {
     if (fill->radial.a < FLT_EPSILON) return;
@@ -221,12 +590,7 @@ void fillFetchRadial(const SwFill* fill, uint32_t* dst, uint32_t y, uint32_t x,
     auto detDelta = (4 * fill->radial.a * (rxryPlus + 1.0f)) * inv2a;
     auto detDelta2 = (4 * fill->radial.a * 2.0f) * inv2a;
 
-   for (uint32_t i = 0 ; i < len ; ++i) {
-        *dst = _pixel(fill, sqrt(det));
-        ++dst;
-        det += detDelta;
-        detDelta += detDelta2;
-    }
+    swKernels.radial[static_cast<int>(fill->spread)](fill->ctable, dst, det, detDelta, detDelta2, len);
 }
 
 
@@ -241,7 +605,7 @@ void fillFetchLinear(const SwFill* fill, uint32_t* dst, uint32_t y, uint32_t x,
     float inc = (fill->linear.dx) * (GRADIENT_STOP_SIZE - 1);
 
     if (fabsf(inc) < FLT_EPSILON) {
-        auto color = _fixedPixel(fill, static_cast<int32_t>(t * FIXPT_SIZE));
+        auto color = fill->ctable[_clamp(fill, _fixedIndex(static_cast<int32_t>(t * FIXPT_SIZE)))];
         rasterRGBA32(dst, color, offset, len);
         return;
     }
@@ -253,20 +617,16 @@ void fillFetchLinear(const SwFill* fill, uint32_t* dst, uint32_t y, uint32_t x,
     auto v = t + (inc * len);
 
     //we can use fixed point math
-    if (v < vMax && v > vMin) {
-        auto t2 = static_cast<uint32_t>(t * FIXPT_SIZE);
-        auto inc2 = static_cast<uint32_t>(inc * FIXPT_SIZE);
-        for (uint32_t j = 0; j < len; ++j) {
-            *dst = _fixedPixel(fill, t2);
-            ++dst;
-            t2 += inc2;
-        }
+    if (v < vMax && v > vMin && t < vMax && t > vMin) {
+        auto t2 = static_cast<int32_t>(t * FIXPT_SIZE);
+        auto inc2 = static_cast<int32_t>(inc * FIXPT_SIZE);
+        swKernels.linear[static_cast<int>(fill->spread)](fill->ctable, dst, t2, inc2, len);
     //we have to fallback to float math
     } else {
-        while (dst < dst + len) {
-            *dst = _pixel(fill, t / GRADIENT_STOP_SIZE);
-            ++dst;
-            t += inc;
+        switch (fill->spread) {
+            case FillSpread::Pad: _linearFloat<FillSpread::Pad>(fill->ctable, dst, t, inc, len); break;
+            case FillSpread::Repeat: _linearFloat<FillSpread::Repeat>(fill->ctable, dst, t, inc, len); break;
+            case FillSpread::Reflect: _linearFloat<FillSpread::Reflect>(fill->ctable, dst, t, inc, len); break;
         }
     }
 }
@@ -296,10 +656,7 @@ bool fillGenColorTable(SwFill* fill, const Fill* fdata, const Matrix* transform,
 
 void fillReset(SwFill* fill)
 {
-    if (fill->ctable) {
-        free(fill->ctable);
-        fill->ctable = nullptr;
-    }
+    _releaseColorTable(fill);
     fill->translucent = false;
 }
 
@@ -308,7 +665,35 @@ void fillFree(SwFill* fill)
 {
     if (!fill) return;
 
-    if (fill->ctable) free(fill->ctable);
+    _releaseColorTable(fill);
 
     free(fill);
+}
+
+
+void fillTerm()
+{
+    unique_lock<mutex> lock{cache.mtx};
+
+    //Tables still referenced belong to living shapes, only the idle ones can go.
+    _trimColorTables(0);
+}
+
+
+void fillCacheLimit(uint32_t cnt)
+{
+    unique_lock<mutex> lock{cache.mtx};
+
+    cache.limit = cnt;
+    _trimColorTables(cnt);
+}
+
+
+void fillCacheStats(uint32_t* hits, uint32_t* misses, uint32_t* tables)
+{
+    unique_lock<mutex> lock{cache.mtx};
+
+    if (hits) *hits = cache.hits;
+    if (misses) *misses = cache.misses;
+    if (tables) *tables = static_cast<uint32_t>(cache.tables.size());
 }
\ No newline at end of file
@@ -25,6 +25,116 @@
 /* Internal Class Implementation                                        */
 /************************************************************************/
 
+static void _rgba32C(uint32_t *dst, uint32_t val, uint32_t offset, int32_t len)
+{
+    dst += offset;
+    while (len-- > 0) *dst++ = val;
+}
+
+
+static void _translucentRgba32C(uint32_t *dst, uint32_t val, uint32_t ialpha, uint32_t offset, int32_t len)
+{
+    //dst = val + dst * ialpha, for premultiplied val
+    dst += offset;
+    while (len-- > 0) {
+        *dst = val + ALPHA_BLEND(*dst, ialpha);
+        ++dst;
+    }
+}
+
+
+#ifdef SW_CPU_DISPATCH
+
+SW_TARGET_SSE2 static void _rgba32Sse2(uint32_t *dst, uint32_t val, uint32_t offset, int32_t len)
+{
+    dst += offset;
+
+    auto sseVal = _mm_set1_epi32(val);
+    for (; len > 3; len -= 4, dst += 4) {
+        _mm_storeu_si128((__m128i*)dst, sseVal);
+    }
+    //Pack Leftovers
+    while (len-- > 0) *dst++ = val;
+}
+
+
+SW_TARGET_SSE2 static void _translucentRgba32Sse2(uint32_t *dst, uint32_t val, uint32_t ialpha, uint32_t offset, int32_t len)
+{
+    dst += offset;
+
+    //Vectorization: 4 pixels, expanded to 16 bits per channel
+    auto sseVal = _mm_set1_epi32(val);
+    auto sseIalpha = _mm_set1_epi16(ialpha);
+    auto sseZero = _mm_setzero_si128();
+    for (; len > 3; len -= 4, dst += 4) {
+        auto px = _mm_loadu_si128((__m128i*)dst);
+        auto lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(px, sseZero), sseIalpha), 8);
+        auto hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(px, sseZero), sseIalpha), 8);
+        _mm_storeu_si128((__m128i*)dst, _mm_add_epi32(sseVal, _mm_packus_epi16(lo, hi)));
+    }
+    //Pack Leftovers
+    while (len-- > 0) {
+        *dst = val + ALPHA_BLEND(*dst, ialpha);
+        ++dst;
+    }
+}
+
+
+SW_TARGET_AVX2 static void _rgba32Avx2(uint32_t *dst, uint32_t val, uint32_t offset, int32_t len)
+{
+    dst += offset;
+
+    //Alignment
+    while (len > 0 && (reinterpret_cast<uintptr_t>(dst) & 31)) {
+        *dst++ = val;
+        --len;
+    }
+    //Vectorization
+    auto avxVal = _mm256_set1_epi32(val);
+    for (; len > 7; len -= 8, dst += 8) {
+        _mm256_store_si256((__m256i*)dst, avxVal);
+    }
+    //Pack Leftovers
+    while (len-- > 0) *dst++ = val;
+}
+
+
+SW_TARGET_AVX2 static void _translucentRgba32Avx2(uint32_t *dst, uint32_t val, uint32_t ialpha, uint32_t offset, int32_t len)
+{
+    dst += offset;
+
+    //Vectorization: 8 pixels, expanded to 16 bits per channel
+    auto avxVal = _mm256_set1_epi32(val);
+    auto avxIalpha = _mm256_set1_epi16(ialpha);
+    auto avxZero = _mm256_setzero_si256();
+    for (; len > 7; len -= 8, dst += 8) {
+        auto px = _mm256_loadu_si256((__m256i*)dst);
+        auto lo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(px, avxZero), avxIalpha), 8);
+        auto hi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(px, avxZero), avxIalpha), 8);
+        _mm256_storeu_si256((__m256i*)dst, _mm256_add_epi32(avxVal, _mm256_packus_epi16(lo, hi)));
+    }
+    //Pack Leftovers
+    while (len-- > 0) {
+        *dst = val + ALPHA_BLEND(*dst, ialpha);
+        ++dst;
+    }
+}
+
+#endif
+
+
+static SwCpu _cpuDetect()
+{
+#ifdef SW_CPU_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SW_CPU_AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return SW_CPU_SSE41;
+    if (__builtin_cpu_supports("sse2")) return SW_CPU_SSE2;
+#endif
+    return SW_CPU_C;
+}
+
+
 static uint32_t _colorAlpha(uint32_t c)
 {
     return (c >> 24) & 0xff;
@@ -57,16 +167,13 @@ static SwBBox _clipRegion(Surface* surface, SwBBox& in)
 
 static bool _rasterTranslucentRect(SwSurface* surface, const SwBBox& region, uint32_t color)
 {
-    auto buffer = surface->buffer + (region.min.y * surface->stride) + region.min.x;
+    auto buffer = surface->buffer + (region.min.y * surface->stride);
     auto h = static_cast<uint32_t>(region.max.y - region.min.y);
     auto w = static_cast<uint32_t>(region.max.x - region.min.x);
     auto ialpha = 255 - surface->comp.alpha(color);
 
     for (uint32_t y = 0; y < h; ++y) {
-        auto dst = &buffer[y * surface->stride];
-        for (uint32_t x = 0; x < w; ++x) {
-            dst[x] = color + ALPHA_BLEND(dst[x], ialpha);
-        }
+        rasterTranslucentRGBA32(buffer + y * surface->stride, color, ialpha, region.min.x, w);
     }
     return true;
 }
@@ -93,13 +200,10 @@ static bool _rasterTranslucentRle(SwSurface* surface, SwRleData* rle, uint32_t c
     uint32_t src;
 
     for (uint32_t i = 0; i < rle->size; ++i) {
-        auto dst = &surface->buffer[span->y * surface->stride + span->x];
         if (span->coverage < 255) src = ALPHA_BLEND(color, span->coverage);
         else src = color;
         auto ialpha = 255 - surface->comp.alpha(src);
-        for (uint32_t i = 0; i < span->len; ++i) {
-            dst[i] = src + ALPHA_BLEND(dst[i], ialpha);
-        }
+        rasterTranslucentRGBA32(surface->buffer + span->y * surface->stride, src, ialpha, span->x, span->len);
         ++span;
     }
     return true;
@@ -116,12 +220,9 @@ static bool _rasterSolidRle(SwSurface* surface, SwRleData* rle, uint32_t color)
         if (span->coverage == 255) {
             rasterRGBA32(surface->buffer + span->y * surface->stride, color, span->x, span->len);
         } else {
-            auto dst = &surface->buffer[span->y * surface->stride + span->x];
             auto src = ALPHA_BLEND(color, span->coverage);
             auto ialpha = 255 - span->coverage;
-            for (uint32_t i = 0; i < span->len; ++i) {
-                dst[i] = src + ALPHA_BLEND(dst[i], ialpha);
-            }
+            rasterTranslucentRGBA32(surface->buffer + span->y * surface->stride, src, ialpha, span->x, span->len);
         }
         ++span;
     }
@@ -288,6 +389,35 @@ static bool _rasterRadialGradientRle(SwSurface* surface, SwRleData* rle, const S
 /* External Class Implementation                                        */
 /************************************************************************/
 
+//Scalar until rasterInit() probes the cpu. Gradient spans are set by fillInit(), outline points by shapeInit()
+SwKernels swKernels = {_rgba32C, _translucentRgba32C, {}, {}, {}};
+
+
+bool rasterInit()
+{
+    auto cpu = _cpuDetect();
+
+    swKernels.rgba32 = _rgba32C;
+    swKernels.translucentRgba32 = _translucentRgba32C;
+
+#ifdef SW_CPU_DISPATCH
+    if (cpu == SW_CPU_AVX2) {
+        swKernels.rgba32 = _rgba32Avx2;
+        swKernels.translucentRgba32 = _translucentRgba32Avx2;
+    } else if (cpu != SW_CPU_C) {
+        //The span blends need no more than SSE2
+        swKernels.rgba32 = _rgba32Sse2;
+        swKernels.translucentRgba32 = _translucentRgba32Sse2;
+    }
+#endif
+
+    fillInit(cpu);
+    shapeInit(cpu);
+
+    return true;
+}
+
+
 bool rasterCompositor(SwSurface* surface)
 {
     if (surface->cs == SwCanvas::ABGR8888) {
@@ -320,14 +450,18 @@ bool rasterGradientShape(SwSurface* surface, SwShape* shape, unsigned id)
 }
 
 
-bool rasterSolidShape(SwSurface* surface, SwShape* shape, uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+uint32_t rasterColor(SwSurface* surface, uint8_t r, uint8_t g, uint8_t b, uint8_t a)
 {
     r = ALPHA_MULTIPLY(r, a);
     g = ALPHA_MULTIPLY(g, a);
     b = ALPHA_MULTIPLY(b, a);
 
-    auto color = surface->comp.join(r, g, b, a);
+    return surface->comp.join(r, g, b, a);
+}
 
+
+bool rasterSolidShape(SwSurface* surface, SwShape* shape, uint32_t color, uint8_t a)
+{
     //Fast Track
     if (shape->rect) {
         auto region = _clipRegion(surface, shape->bbox);
@@ -341,19 +475,29 @@ bool rasterSolidShape(SwSurface* surface, SwShape* shape, uint8_t r, uint8_t g,
 }
 
 
-bool rasterStroke(SwSurface* surface, SwShape* shape, uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+bool rasterStroke(SwSurface* surface, SwShape* shape, uint32_t color, uint8_t a)
 {
-    r = ALPHA_MULTIPLY(r, a);
-    g = ALPHA_MULTIPLY(g, a);
-    b = ALPHA_MULTIPLY(b, a);
-
-    auto color = surface->comp.join(r, g, b, a);
-
     if (a == 255) return _rasterSolidRle(surface, shape->strokeRle, color);
     return _rasterTranslucentRle(surface, shape->strokeRle, color);
 }
 
 
+bool rasterComposite(SwSurface* surface, const uint32_t* buffer, const SwBBox& region, uint8_t opacity)
+{
+    //The offscreen buffer shares the layout of the surface
+    for (auto y = region.min.y; y < region.max.y; ++y) {
+        auto dst = surface->buffer + y * surface->stride;
+        auto src = buffer + y * surface->stride;
+        for (auto x = region.min.x; x < region.max.x; ++x) {
+            if (!src[x]) continue;
+            auto color = ALPHA_BLEND(src[x], opacity);
+            dst[x] = color + ALPHA_BLEND(dst[x], 255 - surface->comp.alpha(color));
+        }
+    }
+    return true;
+}
+
+
 bool rasterClear(SwSurface* surface)
 {
     if (!surface || !surface->buffer || surface->stride <= 0 || surface->w <= 0 || surface->h <= 0) return false;
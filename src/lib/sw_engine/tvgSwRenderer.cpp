@@ -19,6 +19,8 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
  * SOFTWARE.
  */
+#include <algorithm>
+#include <climits>
 #include "tvgSwCommon.h"
 #include "tvgSwRenderer.h"
 
@@ -28,6 +30,50 @@
 static bool initEngine = false;
 static uint32_t rendererCnt = 0;
 
+//Nothing of the shape was cut by the surface
+static bool _whole(const SwShape& shape, const SwSize& clip)
+{
+    auto& bbox = shape.bbox;
+    if (bbox.min.x < 0 || bbox.min.y < 0 || bbox.max.x > clip.w || bbox.max.y > clip.h) return false;
+
+    //The stroke outline isn't kept, its cut spans would lie on the surface edges
+    if (shape.strokeRle) {
+        SwBBox stroke;
+        if (!rleBBox(shape.strokeRle, stroke)) return false;
+        if (stroke.min.x <= 0 || stroke.min.y <= 0 || stroke.max.x >= clip.w || stroke.max.y >= clip.h) return false;
+    }
+    return true;
+}
+
+
+//Clip paths are made of the fills only
+static uint8_t _strokeAlpha(const Shape* sdata, bool clipper)
+{
+    uint8_t alpha = 0;
+    if (HALF_STROKE(sdata->strokeWidth()) > 0 && !clipper) sdata->strokeColor(nullptr, nullptr, nullptr, &alpha);
+    return alpha;
+}
+
+
+static bool _translation(const Matrix* prev, const RenderTransform* next, SwPoint& offset)
+{
+    static const Matrix identity = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+
+    auto& m1 = prev ? *prev : identity;
+    auto& m2 = next ? next->m : identity;
+
+    if (m1.e11 != m2.e11 || m1.e12 != m2.e12 || m1.e21 != m2.e21 || m1.e22 != m2.e22 ||
+        m1.e31 != m2.e31 || m1.e32 != m2.e32 || m1.e33 != m2.e33) return false;
+
+    auto dx = m2.e13 - m1.e13;
+    auto dy = m2.e23 - m1.e23;
+    if (roundf(dx) != dx || roundf(dy) != dy) return false;
+
+    offset = {static_cast<SwCoord>(dx), static_cast<SwCoord>(dy)};
+    return true;
+}
+
+
 struct SwTask : Task
 {
     SwShape shape;
@@ -35,29 +81,41 @@ struct SwTask : Task
     Matrix* transform = nullptr;
     SwSurface* surface = nullptr;
     RenderUpdateFlag flags = RenderUpdateFlag::None;
+    SwBBox painted;                 //drawn region of the last update
+    vector<SwClipPath*> clips;      //clip paths of the shape
+    bool drawn = false;
+    bool clipper = false;           //a shape of a clip path, it's never drawn
+    bool shiftable = false;         //the rles are whole within the surface, they can be moved
+    bool translated = false;        //moved by offset since the last update
+    SwPoint offset;
 
     void run() override
     {
         //Valid Stroking?
-        uint8_t strokeAlpha = 0;
+        auto strokeAlpha = _strokeAlpha(sdata, clipper);
         auto strokeWidth = sdata->strokeWidth();
-        if (HALF_STROKE(strokeWidth) > 0) {
-            sdata->strokeColor(nullptr, nullptr, nullptr, &strokeAlpha);
-        }
 
         SwSize clip = {static_cast<SwCoord>(surface->w), static_cast<SwCoord>(surface->h)};
 
+        //Whole pixel move: the rles of the last update are shifted instead of being generated again
+        if (translated) {
+            shiftable = shapeTranslate(&shape, offset.x, offset.y, clip);
+        } else {
+            shiftable = false;
+        }
+
         //Shape
-        if (flags & (RenderUpdateFlag::Path | RenderUpdateFlag::Transform)) {
+        if (!translated && (flags & (RenderUpdateFlag::Path | RenderUpdateFlag::Transform))) {
             shapeReset(&shape);
             uint8_t alpha = 0;
             sdata->fill(nullptr, nullptr, nullptr, &alpha);
-            bool renderShape = (alpha > 0 || sdata->fill());
+            bool renderShape = (alpha > 0 || sdata->fill() || clipper);
             if (renderShape || strokeAlpha) {
                 if (!shapePrepare(&shape, sdata, clip, transform)) return;
                 if (renderShape) {
-                    auto antiAlias = (strokeAlpha > 0 && strokeWidth >= 2) ? false : true;
-                    if (!shapeGenRle(&shape, sdata, clip, antiAlias)) return;
+                    auto antiAlias = (strokeAlpha > 0 && strokeWidth >= 2) ? false : sdata->antiAlias();
+                    if (!shapeGenRle(&shape, sdata, clip, antiAlias, clipper || !clips.empty())) return;
+                    for (auto clipPath : clips) rleClipPath(shape.rle, clipPath->rle);
                 }
             }
         }
@@ -72,24 +130,422 @@ struct SwTask : Task
                 shapeDelFill(&shape);
             }
         }
-        //Stroke
-        if (flags & (RenderUpdateFlag::Stroke | RenderUpdateFlag::Transform)) {
+        //Stroke, a new color only matters if it shows or hides the stroke
+        auto restroke = (flags & (RenderUpdateFlag::Stroke | RenderUpdateFlag::Transform)) ||
+                        ((flags & RenderUpdateFlag::StrokeColor) && ((strokeAlpha > 0) != (shape.strokeRle != nullptr)));
+        if (!translated && restroke) {
             if (strokeAlpha > 0) {
                 shapeResetStroke(&shape, sdata, transform);
                 if (!shapeGenStrokeRle(&shape, sdata, transform, clip)) return;
+                for (auto clipPath : clips) rleClipPath(shape.strokeRle, clipPath->rle);
             } else {
                 shapeDelStroke(&shape);
             }
         }
-        shapeDelOutline(&shape);
+        shapeResetOutline(&shape);
+
+        if (!translated) shiftable = clips.empty() && _whole(shape, clip);
     }
 };
 
+
+//The colors are read by render(), there is nothing for the task to do
+static bool _rasterOnly(const SwTask* task, const Shape& sdata, RenderUpdateFlag flags)
+{
+    if (flags & (RenderUpdateFlag::Path | RenderUpdateFlag::Gradient | RenderUpdateFlag::Stroke | RenderUpdateFlag::Transform | RenderUpdateFlag::All)) return false;
+
+    //Unless the new stroke color shows or hides the stroke
+    if (flags & RenderUpdateFlag::StrokeColor) {
+        if ((_strokeAlpha(&sdata, task->clipper) > 0) != (task->shape.strokeRle != nullptr)) return false;
+    }
+    return true;
+}
+
+static void _rasterShape(SwSurface* surface, const SwCommand& cmd, SwShape* shape)
+{
+    if (cmd.fill) rasterGradientShape(surface, shape, cmd.fill->id());
+    else if (cmd.alpha > 0) rasterSolidShape(surface, shape, cmd.color, cmd.alpha);
+
+    if (cmd.strokeAlpha > 0) rasterStroke(surface, shape, cmd.strokeColor, cmd.strokeAlpha);
+}
+
+
+static bool _overlapped(const SwBBox& lhs, const SwBBox& rhs)
+{
+    return (lhs.min.x < rhs.max.x && rhs.min.x < lhs.max.x && lhs.min.y < rhs.max.y && rhs.min.y < lhs.max.y);
+}
+
+
+static void _mergeBBox(SwBBox& bbox, const SwBBox& rhs)
+{
+    if (rhs.min.x < bbox.min.x) bbox.min.x = rhs.min.x;
+    if (rhs.min.y < bbox.min.y) bbox.min.y = rhs.min.y;
+    if (rhs.max.x > bbox.max.x) bbox.max.x = rhs.max.x;
+    if (rhs.max.y > bbox.max.y) bbox.max.y = rhs.max.y;
+}
+
+
+static void _clearRegion(SwSurface* surface, const SwBBox& region)
+{
+    auto w = region.max.x - region.min.x;
+    for (auto y = region.min.y; y < region.max.y; ++y) {
+        rasterRGBA32(surface->buffer + y * surface->stride, 0x00000000, region.min.x, w);
+    }
+}
+
+
+struct SwBandTask : Task
+{
+    SwSurface* surface = nullptr;
+    vector<SwCommand>* commands = nullptr;
+    vector<SwBBox>* regions = nullptr;
+    vector<uint32_t*>* layers = nullptr;
+    vector<SwSurface> targets;              //surface, then the composite layers
+    SwCoord min, max;                       //surface rows [min, max)
+    SwRleData rle{};                        //clipped spans
+    SwRleData strokeRle{};
+
+    ~SwBandTask()
+    {
+        if (rle.spans) free(rle.spans);
+        if (strokeRle.spans) free(strokeRle.spans);
+    }
+
+    void run() override
+    {
+        targets.resize(layers->size() + 1);
+        targets[0] = *surface;
+        for (uint32_t i = 0; i < layers->size(); ++i) {
+            targets[i + 1] = *surface;
+            targets[i + 1].buffer = (*layers)[i];
+        }
+
+        for (auto& region : *regions) {
+            auto clip = region;
+            if (clip.min.y < min) clip.min.y = min;
+            if (clip.max.y > max) clip.max.y = max;
+            if (clip.min.y >= clip.max.y) continue;
+            _rasterRegion(clip);
+        }
+    }
+
+    void _rasterTask(SwSurface* target, const SwCommand& cmd, SwTask* task, const SwBBox& clip)
+    {
+        auto shape = task->shape;
+        SwRleData rleSliced, strokeRleSliced;
+        if (clip.max.x - clip.min.x == static_cast<SwCoord>(surface->w)) {
+            shape.rle = rleSlice(task->shape.rle, clip.min.y, clip.max.y, rleSliced) ? &rleSliced : nullptr;
+            shape.strokeRle = rleSlice(task->shape.strokeRle, clip.min.y, clip.max.y, strokeRleSliced) ? &strokeRleSliced : nullptr;
+        } else {
+            shape.rle = rleClipRect(task->shape.rle, clip, rle) ? &rle : nullptr;
+            shape.strokeRle = rleClipRect(task->shape.strokeRle, clip, strokeRle) ? &strokeRle : nullptr;
+        }
+        if (shape.rect) {
+            if (shape.bbox.min.x < clip.min.x) shape.bbox.min.x = clip.min.x;
+            if (shape.bbox.min.y < clip.min.y) shape.bbox.min.y = clip.min.y;
+            if (shape.bbox.max.x > clip.max.x) shape.bbox.max.x = clip.max.x;
+            if (shape.bbox.max.y > clip.max.y) shape.bbox.max.y = clip.max.y;
+            if (shape.bbox.min.x >= shape.bbox.max.x || shape.bbox.min.y >= shape.bbox.max.y) shape.rect = false;
+        }
+        _rasterShape(target, cmd, &shape);
+    }
+
+    void _rasterRegion(const SwBBox& clip)
+    {
+        auto target = &targets[0];
+
+        _clearRegion(target, clip);
+
+        //Keep the painter's order inside the region
+        auto& cmds = *commands;
+        for (uint32_t i = 0; i < cmds.size();) {
+            auto& cmd = cmds[i];
+
+            //Skip the whole batch or composite out of the region
+            if (!_overlapped(cmd.bbox, clip)) {
+                i += cmd.cnt;
+                continue;
+            }
+
+            auto area = clip;
+            if (area.min.x < cmd.bbox.min.x) area.min.x = cmd.bbox.min.x;
+            if (area.min.y < cmd.bbox.min.y) area.min.y = cmd.bbox.min.y;
+            if (area.max.x > cmd.bbox.max.x) area.max.x = cmd.bbox.max.x;
+            if (area.max.y > cmd.bbox.max.y) area.max.y = cmd.bbox.max.y;
+
+            switch (cmd.type) {
+                case SW_COMMAND_BEGIN_COMPOSITE: {
+                    target = &targets[cmd.depth + 1];
+                    _clearRegion(target, area);
+                    ++i;
+                    break;
+                }
+                case SW_COMMAND_END_COMPOSITE: {
+                    auto parent = &targets[cmd.depth];
+                    rasterComposite(parent, target->buffer, area, cmd.opacity);
+                    target = parent;
+                    ++i;
+                    break;
+                }
+                default: {
+                    //Batched commands share the state of the first one
+                    for (auto j = i; j < i + cmd.cnt; ++j) {
+                        if (_overlapped(cmds[j].task->painted, clip)) _rasterTask(target, cmd, cmds[j].task, clip);
+                    }
+                    i += cmd.cnt;
+                    break;
+                }
+            }
+        }
+    }
+};
+
+
+static bool _paintedBBox(SwTask* task, SwBBox& bbox)
+{
+    auto& shape = task->shape;
+    auto valid = false;
+
+    if (shape.rect) {
+        bbox = shape.bbox;
+        valid = true;
+    } else {
+        valid = rleBBox(shape.rle, bbox);
+    }
+
+    SwBBox stroke;
+    if (rleBBox(shape.strokeRle, stroke)) {
+        if (!valid) {
+            bbox = stroke;
+            return true;
+        }
+        if (stroke.min.x < bbox.min.x) bbox.min.x = stroke.min.x;
+        if (stroke.min.y < bbox.min.y) bbox.min.y = stroke.min.y;
+        if (stroke.max.x > bbox.max.x) bbox.max.x = stroke.max.x;
+        if (stroke.max.y > bbox.max.y) bbox.max.y = stroke.max.y;
+        valid = true;
+    }
+    return valid;
+}
+
+
+static void _updatePainted(SwTask* task, vector<SwBBox>& damages)
+{
+    task->get();
+    if (task->clipper) return;
+    task->drawn = _paintedBBox(task, task->painted);
+    if (task->drawn) damages.push_back(task->painted);
+}
+
+
+//Overlapping rects are merged, so no pixel is composited twice
+static bool _mergeDamages(vector<SwBBox>& damages, const SwSurface* surface)
+{
+    constexpr auto MAX_DAMAGES = 16;
+
+    SwCoord w = surface->w;
+    SwCoord h = surface->h;
+
+    //Clip to the surface
+    for (auto damage = damages.begin(); damage != damages.end();) {
+        if (damage->min.x < 0) damage->min.x = 0;
+        if (damage->min.y < 0) damage->min.y = 0;
+        if (damage->max.x > w) damage->max.x = w;
+        if (damage->max.y > h) damage->max.y = h;
+        if (damage->min.x >= damage->max.x || damage->min.y >= damage->max.y) damage = damages.erase(damage);
+        else ++damage;
+    }
+
+    auto merged = true;
+    while (merged) {
+        merged = false;
+        for (uint32_t i = 0; i < damages.size() && !merged; ++i) {
+            for (uint32_t j = i + 1; j < damages.size(); ++j) {
+                if (!_overlapped(damages[i], damages[j])) continue;
+                auto& lhs = damages[i];
+                auto& rhs = damages[j];
+                if (rhs.min.x < lhs.min.x) lhs.min.x = rhs.min.x;
+                if (rhs.min.y < lhs.min.y) lhs.min.y = rhs.min.y;
+                if (rhs.max.x > lhs.max.x) lhs.max.x = rhs.max.x;
+                if (rhs.max.y > lhs.max.y) lhs.max.y = rhs.max.y;
+                damages.erase(damages.begin() + j);
+                merged = true;
+                break;
+            }
+        }
+    }
+
+    //Too fragmented or too large: redraw the whole surface
+    if (damages.size() > MAX_DAMAGES) return false;
+
+    SwCoord area = 0;
+    for (auto& damage : damages) area += (damage.max.x - damage.min.x) * (damage.max.y - damage.min.y);
+    if (area * 2 > w * h) return false;
+
+    return true;
+}
+
+
+//Does the command cover its whole bbox with opaque pixels?
+static bool _opaqueRect(const SwCommand& cmd)
+{
+    auto& shape = cmd.task->shape;
+    if (!shape.rect) return false;
+
+    if (cmd.fill) return (shape.fill && !shape.fill->translucent);
+    return (cmd.alpha == 255);
+}
+
+
+static bool _covered(const SwBBox& bbox, const SwBBox& occluder)
+{
+    return (bbox.min.x >= occluder.min.x && bbox.min.y >= occluder.min.y &&
+            bbox.max.x <= occluder.max.x && bbox.max.y <= occluder.max.y);
+}
+
+
+struct SwOccluders
+{
+    static constexpr auto MAX_OCCLUDERS = 8;
+
+    SwBBox bboxes[MAX_OCCLUDERS];
+    SwCoord areas[MAX_OCCLUDERS];
+    uint32_t cnt = 0;
+};
+
+
+//Walk back to front and drop the commands hidden behind the later opaque rects
+static void _cullOccluded(vector<SwCommand>& cmds)
+{
+    //Occluders inside a composite don't hide what's underneath it
+    vector<SwOccluders> stack(1);
+    auto culled = false;
+
+    for (auto cmd = cmds.rbegin(); cmd != cmds.rend(); ++cmd) {
+        if (cmd->type == SW_COMMAND_END_COMPOSITE) {
+            stack.push_back(stack.back());
+            continue;
+        }
+        if (cmd->type == SW_COMMAND_BEGIN_COMPOSITE) {
+            stack.pop_back();
+            continue;
+        }
+
+        auto& occluders = stack.back();
+        auto hidden = false;
+        for (uint32_t i = 0; i < occluders.cnt; ++i) {
+            if (_covered(cmd->task->painted, occluders.bboxes[i])) {
+                hidden = true;
+                break;
+            }
+        }
+        if (hidden) {
+            cmd->cnt = 0;
+            culled = true;
+            continue;
+        }
+
+        if (!_opaqueRect(*cmd)) continue;
+
+        //Keep the largest occluders
+        auto& bbox = cmd->task->shape.bbox;
+        auto area = (bbox.max.x - bbox.min.x) * (bbox.max.y - bbox.min.y);
+        auto idx = occluders.cnt;
+        if (occluders.cnt == SwOccluders::MAX_OCCLUDERS) {
+            idx = 0;
+            for (uint32_t i = 1; i < occluders.cnt; ++i) {
+                if (occluders.areas[i] < occluders.areas[idx]) idx = i;
+            }
+            if (occluders.areas[idx] >= area) continue;
+        } else {
+            ++occluders.cnt;
+        }
+        occluders.bboxes[idx] = bbox;
+        occluders.areas[idx] = area;
+    }
+
+    if (culled) cmds.erase(remove_if(cmds.begin(), cmds.end(), [](const SwCommand& cmd) { return cmd.cnt == 0; }), cmds.end());
+}
+
+
+//Consecutive solid fills of the same color form a batch, culled and rasterized together
+static void _batchCommands(vector<SwCommand>& cmds)
+{
+    SwCommand* lead = nullptr;
+
+    for (auto& cmd : cmds) {
+        cmd.cnt = 1;
+        if (cmd.type != SW_COMMAND_SHAPE) {
+            lead = nullptr;
+            continue;
+        }
+
+        cmd.bbox = cmd.task->painted;
+
+        auto batchable = (!cmd.fill && cmd.strokeAlpha == 0);
+        if (batchable && lead && lead->color == cmd.color && lead->alpha == cmd.alpha) {
+            _mergeBBox(lead->bbox, cmd.bbox);
+            ++lead->cnt;
+            continue;
+        }
+        lead = batchable ? &cmd : nullptr;
+    }
+}
+
+
+//Pair up the composite commands, returns the deepest nesting level
+static uint32_t _linkComposites(vector<SwCommand>& cmds)
+{
+    vector<uint32_t> stack;
+    uint32_t depth = 0;
+
+    for (uint32_t i = 0; i < cmds.size(); ++i) {
+        auto& cmd = cmds[i];
+        if (cmd.type == SW_COMMAND_BEGIN_COMPOSITE) {
+            //Grows with the painted regions of the children
+            cmd.bbox.min.x = cmd.bbox.min.y = LONG_MAX;
+            cmd.bbox.max.x = cmd.bbox.max.y = LONG_MIN;
+            cmd.depth = stack.size();
+            stack.push_back(i);
+            if (stack.size() > depth) depth = stack.size();
+        } else if (cmd.type == SW_COMMAND_END_COMPOSITE) {
+            auto& begin = cmds[stack.back()];
+            begin.cnt = i - stack.back() + 1;
+            stack.pop_back();
+            cmd.bbox = begin.bbox;
+            cmd.depth = begin.depth;
+            cmd.opacity = begin.opacity;
+            if (!stack.empty()) _mergeBBox(cmds[stack.back()].bbox, cmd.bbox);
+        } else if (!stack.empty()) {
+            _mergeBBox(cmds[stack.back()].bbox, cmd.bbox);
+        }
+    }
+    return depth;
+}
+
+
+static uint32_t _bandCnt(const SwSurface* surface)
+{
+    constexpr auto MIN_BAND_HEIGHT = 32;
+
+    auto threads = TaskScheduler::threads();
+    if (threads == 0) return 1;
+
+    //A couple of bands per worker for load balancing
+    auto cnt = threads * 2;
+    if (cnt > surface->h / MIN_BAND_HEIGHT) cnt = surface->h / MIN_BAND_HEIGHT;
+    if (cnt < 2) return 1;
+    return cnt;
+}
+
+
 static void _termEngine()
 {
     if (rendererCnt > 0) return;
 
-    //TODO: Clean up global resources
+    //Release the cached gradient color tables and the rle helpers
+    fillTerm();
+    rleTerm();
 }
 
 
@@ -101,6 +557,13 @@ SwRenderer::~SwRenderer()
 {
     clear();
 
+    for (auto band : bands) delete(band);
+
+    clearPool();
+
+    //The shapes have been disposed already
+    rlePoolTerm(spanPool);
+
     if (surface) delete(surface);
 
     --rendererCnt;
@@ -122,48 +585,328 @@ bool SwRenderer::target(uint32_t* buffer, uint32_t stride, uint32_t w, uint32_t
     if (!buffer || stride == 0 || w == 0 || h == 0) return false;
 
     if (!surface) {
-        surface = new SwSurface;
+        surface = new SwSurface();
         if (!surface) return false;
     }
 
+    //Pooled buffers of the previous size won't fit anymore
+    if (surface->stride * surface->h != stride * h) clearPool();
+
     surface->buffer = buffer;
     surface->stride = stride;
     surface->w = w;
     surface->h = h;
     surface->cs = cs;
 
+    //New target, nothing to preserve
+    fullDamage = true;
+
     return rasterCompositor(surface);
 }
 
 
+uint32_t SwRenderer::damage(const SwCanvas::Region** regions) const
+{
+    if (regions) *regions = damaged.data();
+    return damaged.size();
+}
+
+
 bool SwRenderer::preRender()
 {
-    return rasterClear(surface);
+    if (!surface) return false;
+
+    //Updated shapes: their new regions are damaged as well.
+    //Take the finished ones first, then wait for the rest.
+    for (auto& task : tasks) {
+        if (!task->ready()) continue;
+        _updatePainted(task, damages);
+        task = nullptr;
+    }
+    for (auto task : tasks) {
+        if (task) _updatePainted(task, damages);
+    }
+    tasks.clear();
+    if (!fullDamage) fullDamage = !_mergeDamages(damages, surface);
+
+    regions.clear();
+    if (fullDamage) regions.push_back({{0, 0}, {static_cast<SwCoord>(surface->w), static_cast<SwCoord>(surface->h)}});
+    else regions = damages;
+
+    damaged.clear();
+    for (auto& region : regions) {
+        damaged.push_back({static_cast<uint32_t>(region.min.x), static_cast<uint32_t>(region.min.y),
+                           static_cast<uint32_t>(region.max.x - region.min.x), static_cast<uint32_t>(region.max.y - region.min.y)});
+    }
+
+    bandCnt = _bandCnt(surface);
+    depth = 0;
+
+    //The regions are cleared by the bands in postRender()
+    return true;
 }
 
 
 bool SwRenderer::postRender()
 {
-    tasks.clear();
+    //Unbalanced composites? Close them
+    while (depth > 0) endComposite();
+
+    _cullOccluded(commands);
+    _batchCommands(commands);
+
+    //One offscreen buffer per nesting level, shared by the bands
+    auto size = surface->stride * surface->h;
+    layers.resize(_linkComposites(commands));
+    for (auto& layer : layers) {
+        layer = allocBuffer(size);
+        if (!layer) {
+            for (auto layer : layers) freeBuffer(layer, size);
+            layers.clear();
+            commands.clear();
+            return false;
+        }
+    }
+
+    if (!regions.empty()) {
+        //Composite the surface bands on the workers
+        while (bands.size() < bandCnt) bands.push_back(new SwBandTask);
+
+        auto bandHeight = static_cast<SwCoord>((surface->h + bandCnt - 1) / bandCnt);
+        SwCoord min = 0;
+
+        for (uint32_t i = 0; i < bandCnt; ++i, min += bandHeight) {
+            auto band = bands[i];
+            band->surface = surface;
+            band->commands = &commands;
+            band->regions = &regions;
+            band->layers = &layers;
+            band->min = min;
+            band->max = (i == bandCnt - 1) ? static_cast<SwCoord>(surface->h) : min + bandHeight;
+            if (bandCnt > 1) TaskScheduler::request(band);
+            else band->run();
+        }
+        if (bandCnt > 1) {
+            for (uint32_t i = 0; i < bandCnt; ++i) bands[i]->get();
+        }
+    }
+
+    for (auto layer : layers) freeBuffer(layer, size);
+    layers.clear();
+
+    commands.clear();
+    damages.clear();
+    fullDamage = false;
+
+    return true;
+}
+
+
+bool SwRenderer::beginComposite(uint8_t opacity)
+{
+    if (regions.empty()) return true;
+
+    SwCommand cmd;
+    cmd.task = nullptr;
+    cmd.cnt = 1;
+    cmd.opacity = opacity;
+    cmd.type = SW_COMMAND_BEGIN_COMPOSITE;
+    commands.push_back(cmd);
+
+    ++depth;
+
+    return true;
+}
+
+
+bool SwRenderer::endComposite()
+{
+    if (depth == 0) return true;
+
+    //Nothing recorded in between
+    if (commands.back().type == SW_COMMAND_BEGIN_COMPOSITE) {
+        commands.pop_back();
+    } else {
+        SwCommand cmd;
+        cmd.task = nullptr;
+        cmd.cnt = 1;
+        cmd.type = SW_COMMAND_END_COMPOSITE;
+        commands.push_back(cmd);
+    }
+
+    --depth;
 
     return true;
 }
 
 
-bool SwRenderer::render(const Shape& shape, void *data)
+bool SwRenderer::beginClipPath()
+{
+    clipFrames.emplace_back();
+
+    return true;
+}
+
+
+void* SwRenderer::endClipPath(void* data)
+{
+    if (clipFrames.empty()) return data;
+
+    auto clipPath = static_cast<SwClipPath*>(data);
+    if (!clipPath) {
+        clipPath = new SwClipPath;
+        if (!clipPath) {
+            clipFrames.pop_back();
+            return nullptr;
+        }
+    }
+
+    auto& frame = clipFrames.back();
+    clipPath->updated = (frame.updated || frame.tasks != clipPath->tasks || !clipPath->rle);
+
+    if (clipPath->updated) {
+        //Its shapes must be done and nobody may read the clip path while it's rebuilt, the rest runs on
+        for (auto task : frame.tasks) task->get();
+        for (auto task : tasks) {
+            for (auto clip : task->clips) {
+                if (clip == clipPath) {
+                    task->get();
+                    break;
+                }
+            }
+        }
+
+        clipPath->tasks = move(frame.tasks);
+        if (!clipPath->rle) {
+            clipPath->rle = static_cast<SwRleData*>(calloc(1, sizeof(SwRleData)));
+            if (clipPath->rle) clipPath->rle->pool = spanPool;
+        }
+        if (clipPath->rle) {
+            rleReset(clipPath->rle);
+            for (auto task : clipPath->tasks) rleAddPath(clipPath->rle, task->shape.rle);
+        }
+    }
+
+    clipFrames.pop_back();
+    clipPaths.push_back(clipPath);
+
+    return clipPath;
+}
+
+
+bool SwRenderer::popClipPath()
+{
+    if (clipPaths.empty()) return false;
+
+    clipPaths.pop_back();
+
+    return true;
+}
+
+
+bool SwRenderer::disposeClipPath(void* data)
+{
+    auto clipPath = static_cast<SwClipPath*>(data);
+    if (!clipPath) return true;
+
+    rleFree(clipPath->rle);
+    delete(clipPath);
+
+    return true;
+}
+
+
+uint32_t* SwRenderer::allocBuffer(uint32_t size)
+{
+    uint32_t bucket = 0;
+    while ((1u << bucket) < size) ++bucket;
+
+    if (!pool[bucket].empty()) {
+        auto buffer = pool[bucket].back();
+        pool[bucket].pop_back();
+        return buffer;
+    }
+    return static_cast<uint32_t*>(malloc((1u << bucket) * sizeof(uint32_t)));
+}
+
+
+bool SwRenderer::trim()
+{
+    clearPool();
+    rlePoolTrim(spanPool);
+
+    return true;
+}
+
+
+void SwRenderer::stats(SwCanvas::Stats* stats) const
+{
+    //The color tables and the rle bands are counted for all the renderers
+    fillCacheStats(&stats->gradientHits, &stats->gradientMisses, &stats->gradientTables);
+    stats->bandShoots = rleBandShoots();
+
+    //Spans memory of this renderer
+    rlePoolStats(spanPool, &stats->spansUsed, &stats->spansIdle, &stats->spansHighWater);
+}
+
+
+void SwRenderer::clearPool()
+{
+    for (auto& bucket : pool) {
+        for (auto buffer : bucket) free(buffer);
+        bucket.clear();
+    }
+}
+
+
+void SwRenderer::freeBuffer(uint32_t* buffer, uint32_t size)
+{
+    if (!buffer) return;
+
+    uint32_t bucket = 0;
+    while ((1u << bucket) < size) ++bucket;
+
+    pool[bucket].push_back(buffer);
+}
+
+
+bool SwRenderer::render(const Shape& sdata, void *data)
 {
     auto task = static_cast<SwTask*>(data);
-    task->get();
 
+    //The task has been finished in preRender()
+    if (regions.empty() || !task->drawn) return true;
+
+    auto& shape = task->shape;
+    SwCommand cmd;
+    cmd.task = task;
+    cmd.fill = nullptr;
+    cmd.alpha = 0;
+    cmd.strokeAlpha = 0;
+
+    cmd.cnt = 1;
+    cmd.type = SW_COMMAND_SHAPE;
+
+    //Record the state of this frame, the rasterization happens in postRender()
     uint8_t r, g, b, a;
-    if (auto fill = task->sdata->fill()) {
-        rasterGradientShape(surface, &task->shape, fill->id());
-    } else{
-        task->sdata->fill(&r, &g, &b, &a);
-        if (a > 0) rasterSolidShape(surface, &task->shape, r, g, b, a);
+    if (shape.rect || (shape.rle && shape.rle->size > 0)) {
+        cmd.fill = sdata.fill();
+        if (!cmd.fill) {
+            sdata.fill(&r, &g, &b, &a);
+            cmd.color = rasterColor(surface, r, g, b, a);
+            cmd.alpha = a;
+        }
+    }
+    if (shape.strokeRle && shape.strokeRle->size > 0) {
+        sdata.strokeColor(&r, &g, &b, &a);
+        cmd.strokeColor = rasterColor(surface, r, g, b, a);
+        cmd.strokeAlpha = a;
     }
-    task->sdata->strokeColor(&r, &g, &b, &a);
-    if (a > 0) rasterStroke(surface, &task->shape, r, g, b, a);
+
+    //Skip the empty ones
+    if (!cmd.fill && cmd.alpha == 0 && cmd.strokeAlpha == 0) return true;
+
+    commands.push_back(cmd);
 
     return true;
 }
@@ -175,6 +918,10 @@ bool SwRenderer::dispose(TVG_UNUSED const Shape& sdata, void *data)
     if (!task) return true;
 
     task->get();
+
+    //Uncover the region
+    if (task->drawn) damages.push_back(task->painted);
+
     shapeFree(&task->shape);
     if (task->transform) free(task->transform);
     delete(task);
@@ -190,12 +937,38 @@ void* SwRenderer::prepare(const Shape& sdata, void* data, const RenderTransform*
     if (!task) {
         task = new SwTask;
         if (!task) return nullptr;
+        task->shape.pool = spanPool;
+    }
+
+    //A shape of the clip path being collected
+    if (!clipFrames.empty()) {
+        task->clipper = true;
+        clipFrames.back().tasks.push_back(task);
+        if (flags != RenderUpdateFlag::None && !task->valid() && !_rasterOnly(task, sdata, flags)) clipFrames.back().updated = true;
+    //The clip paths changed, the shape is clipped again
+    } else if (!task->clipper) {
+        auto reclip = (task->clips != clipPaths);
+        for (auto clipPath : clipPaths) {
+            if (clipPath->updated) reclip = true;
+        }
+        if (reclip) flags = static_cast<RenderUpdateFlag>(flags | RenderUpdateFlag::Path);
     }
 
     if (flags == RenderUpdateFlag::None || task->valid()) return task;
 
+    //The previous region is damaged
+    if (task->drawn) damages.push_back(task->painted);
+
     task->sdata = &sdata;
 
+    //Same region in new colors, no need to schedule the task
+    if (_rasterOnly(task, sdata, flags)) return task;
+
+    //Moved by whole pixels only?
+    task->translated = task->shiftable && (flags & RenderUpdateFlag::Transform) &&
+                       !(flags & (RenderUpdateFlag::Path | RenderUpdateFlag::Stroke | RenderUpdateFlag::StrokeColor)) &&
+                       _translation(task->transform, transform, task->offset);
+
     if (transform) {
         if (!task->transform) task->transform = static_cast<Matrix*>(malloc(sizeof(Matrix)));
         *task->transform = transform->m;
@@ -206,6 +979,7 @@ void* SwRenderer::prepare(const Shape& sdata, void* data, const RenderTransform*
 
     task->surface = surface;
     task->flags = flags;
+    if (!task->clipper) task->clips = clipPaths;
 
     tasks.push_back(task);
     TaskScheduler::request(task);
@@ -219,7 +993,8 @@ bool SwRenderer::init()
     if (rendererCnt > 0) return false;
     if (initEngine) return true;
 
-    //TODO:
+    //Pick the raster kernels for the host cpu
+    if (!rasterInit()) return false;
 
     initEngine = true;
 
@@ -238,8 +1013,19 @@ bool SwRenderer::term()
     return true;
 }
 
+
+bool SwRenderer::gradientCache(uint32_t cnt)
+{
+    fillCacheLimit(cnt);
+
+    return true;
+}
+
+
 SwRenderer* SwRenderer::gen()
 {
     ++rendererCnt;
-    return new SwRenderer();
+    auto renderer = new SwRenderer();
+    renderer->spanPool = rlePoolInit();
+    return renderer;
 }
@@ -22,8 +22,43 @@
 #ifndef _TVG_SW_RENDERER_H_
 #define _TVG_SW_RENDERER_H_
 
-struct SwSurface;
+#include "tvgSwCommon.h"
+
 struct SwTask;
+struct SwBandTask;
+
+//Union of the shapes prepared between beginClipPath() and endClipPath()
+struct SwClipPath
+{
+    vector<SwTask*> tasks;
+    SwRleData* rle = nullptr;
+    bool updated = false;           //rebuilt by the current update
+};
+
+//Shapes of a clip path being collected
+struct SwClipFrame
+{
+    vector<SwTask*> tasks;
+    bool updated = false;
+};
+
+enum SwCommandType {SW_COMMAND_SHAPE = 0, SW_COMMAND_BEGIN_COMPOSITE, SW_COMMAND_END_COMPOSITE};
+
+//Recorded by render(), executed by postRender()
+struct SwCommand
+{
+    SwTask* task;                   //nullptr for the composite commands
+    SwBBox bbox;                    //painted region of the whole batch or composite
+    uint32_t cnt;                   //commands covered by this one, itself included
+    const Fill* fill;               //gradient, nullptr for a solid fill
+    uint32_t color;
+    uint32_t strokeColor;
+    uint32_t depth;                 //nesting level of the composite
+    uint8_t alpha;
+    uint8_t strokeAlpha;
+    uint8_t opacity;                //composite opacity
+    uint8_t type;
+};
 
 namespace tvg
 {
@@ -38,17 +73,44 @@ public:
     bool target(uint32_t* buffer, uint32_t stride, uint32_t w, uint32_t h, uint32_t cs);
     bool clear() override;
     bool render(const Shape& shape, void *data) override;
+    bool beginComposite(uint8_t opacity) override;
+    bool endComposite() override;
+    bool beginClipPath() override;
+    void* endClipPath(void* data) override;
+    bool popClipPath() override;
+    bool disposeClipPath(void* data) override;
+    uint32_t damage(const SwCanvas::Region** regions) const;
+    bool trim();
+    void stats(SwCanvas::Stats* stats) const;
 
     static SwRenderer* gen();
     static bool init();
     static bool term();
+    static bool gradientCache(uint32_t cnt);
 
 private:
     SwSurface* surface = nullptr;
     vector<SwTask*> tasks;
+    vector<SwCommand> commands;
+    vector<SwBandTask*> bands;
+    vector<SwBBox> damages;                 //updated regions since the last draw
+    vector<SwBBox> regions;                 //regions to redraw
+    vector<SwCanvas::Region> damaged;       //regions redrawn by the last draw
+    vector<uint32_t*> layers;               //offscreen buffers of the composites, by nesting level
+    vector<uint32_t*> pool[32];             //idle offscreen buffers, bucketed by log2 of their size
+    SwSpanPool* spanPool = nullptr;         //spans memory of the shapes
+    vector<SwClipFrame> clipFrames;         //clip paths being collected
+    vector<SwClipPath*> clipPaths;          //clip paths applied to the prepared shapes
+    uint32_t bandCnt = 1;
+    uint32_t depth = 0;                     //composites being recorded
+    bool fullDamage = true;
 
     SwRenderer(){};
     ~SwRenderer();
+
+    uint32_t* allocBuffer(uint32_t size);
+    void freeBuffer(uint32_t* buffer, uint32_t size);
+    void clearPool();
 };
 
 }
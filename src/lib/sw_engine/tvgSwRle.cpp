@@ -22,6 +22,10 @@
 #include <setjmp.h>
 #include <limits.h>
 #include <memory.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include "tvgSwCommon.h"
 
 /************************************************************************/
@@ -47,6 +51,36 @@ struct Cell
     Cell *next;
 };
 
+/* Cells are allocated in blocks that never move, so a band grows its storage
+   in place instead of being rendered again at half height. */
+constexpr auto ARENA_BLOCK_CELLS = 2048;
+
+struct RleArena
+{
+    Cell** yCells = nullptr;
+    SwCoord yCellsCnt = 0;
+    vector<Cell*> blocks;
+
+    //Accumulation buffers of the dense rasterizer
+    Area* areas = nullptr;
+    SwCoord* covers = nullptr;
+    uint32_t accumCnt = 0;
+
+    ~RleArena()
+    {
+        free(yCells);
+        for (auto block : blocks) free(block);
+        free(areas);
+        free(covers);
+    }
+};
+
+//Kept for the next renders of the thread
+static thread_local RleArena arena;
+
+//Bands that wouldn't have fit in the former 16KB render pool
+static atomic<uint32_t> bandShoots{0};
+
 struct RleWorker
 {
     SwRleData* rle;
@@ -60,9 +94,10 @@ struct RleWorker
     Area area;
     SwCoord cover;
 
-    Cell* cells;
+    Cell* cells;                    //current arena block
     ptrdiff_t maxCells;
     ptrdiff_t cellsCnt;
+    uint32_t block;
 
     SwPoint pos;
 
@@ -75,21 +110,20 @@ struct RleWorker
     int spansCnt;
     int ySpan;
 
-    int bandSize;
-    int bandShoot;
-
     jmp_buf jmpBuf;
 
-    void* buffer;
-    long bufferSize;
-
     Cell** yCells;
     SwCoord yCnt;
 
+    //Dense mode: the cells of the band are accumulated in place, the column 0 is the one at x = -1
+    Area* areas;
+    SwCoord* covers;
+    SwCoord stride;
+
     SwSize clip;
 
     bool invalid;
-    bool antiAlias;
+    bool accumulate;
 };
 
 
@@ -140,6 +174,135 @@ static inline SwCoord HYPOT(SwPoint pt)
     return ((pt.x > pt.y) ? (pt.x + (3 * pt.y >> 3)) : (pt.y + (3 * pt.x >> 3)));
 }
 
+/* Span buffers of the rle data are recycled by the renderer.
+   Their capacities are powers of two so that a freed buffer fits the next request of its size class. */
+struct SwSpanPool
+{
+    vector<SwSpan*> buckets[32];    //idle buffers, bucketed by log2 of their capacity
+    mutex mtx;
+    uint32_t used = 0;              //spans held by the rle data
+    uint32_t idle = 0;              //spans kept in the buckets
+    uint32_t highWater = 0;         //peak of used + idle
+};
+
+
+static uint32_t _bucket(uint32_t size)
+{
+    uint32_t bucket = 0;
+    while ((1u << bucket) < size) ++bucket;
+    return bucket;
+}
+
+
+static SwSpan* _poolAlloc(SwSpanPool* pool, uint32_t size, uint32_t& alloc)
+{
+    auto bucket = _bucket(size);
+    alloc = (1u << bucket);
+
+    unique_lock<mutex> lock{pool->mtx};
+
+    if (!pool->buckets[bucket].empty()) {
+        auto spans = pool->buckets[bucket].back();
+        pool->buckets[bucket].pop_back();
+        pool->idle -= alloc;
+        pool->used += alloc;
+        return spans;
+    }
+
+    auto spans = static_cast<SwSpan*>(malloc(alloc * sizeof(SwSpan)));
+    if (!spans) return nullptr;
+
+    pool->used += alloc;
+    if (pool->used + pool->idle > pool->highWater) pool->highWater = pool->used + pool->idle;
+
+    return spans;
+}
+
+
+static void _poolFree(SwSpanPool* pool, SwSpan* spans, uint32_t alloc)
+{
+    unique_lock<mutex> lock{pool->mtx};
+
+    pool->buckets[_bucket(alloc)].push_back(spans);
+    pool->used -= alloc;
+    pool->idle += alloc;
+}
+
+
+static bool _growSpans(SwRleData* rle, uint32_t size)
+{
+    if (rle->alloc >= size) return true;
+
+    if (!rle->pool) {
+        auto spans = static_cast<SwSpan*>(realloc(rle->spans, size * 2 * sizeof(SwSpan)));
+        if (!spans) return false;
+        rle->spans = spans;
+        rle->alloc = size * 2;
+        return true;
+    }
+
+    uint32_t alloc;
+    auto spans = _poolAlloc(rle->pool, size, alloc);
+    if (!spans) return false;
+
+    if (rle->spans) {
+        memcpy(spans, rle->spans, rle->size * sizeof(SwSpan));
+        _poolFree(rle->pool, rle->spans, rle->alloc);
+    }
+    rle->spans = spans;
+    rle->alloc = alloc;
+
+    return true;
+}
+
+
+static bool _growRows(SwRleData* rle, uint32_t cnt)
+{
+    //One more for the end of the last row
+    if (rle->rowAlloc < cnt + 1) {
+        auto rows = static_cast<uint32_t*>(realloc(rle->rows, (cnt + 1) * sizeof(uint32_t)));
+        if (!rows) return false;
+        rle->rows = rows;
+        rle->rowAlloc = cnt + 1;
+    }
+    rle->rowCnt = cnt;
+    return true;
+}
+
+
+//Clip the spans of a single row, which are sorted by x
+static SwSpan* _clipRow(const SwSpan* begin, const SwSpan* end, const SwBBox& clip, SwSpan* dst)
+{
+    auto span = lower_bound(begin, end, clip.min.x, [](const SwSpan& span, SwCoord x) { return span.x + span.len <= x; });
+
+    for (; span < end && span->x < clip.max.x; ++span) {
+        auto x1 = span->x;
+        auto x2 = span->x + span->len;
+        if (x1 < clip.min.x) x1 = clip.min.x;
+        if (x2 > clip.max.x) x2 = clip.max.x;
+        dst->x = x1;
+        dst->y = span->y;
+        dst->len = x2 - x1;
+        dst->coverage = span->coverage;
+        ++dst;
+    }
+    return dst;
+}
+
+
+static void _freeSpans(SwRleData* rle)
+{
+    if (!rle->spans) return;
+
+    if (rle->pool) _poolFree(rle->pool, rle->spans, rle->alloc);
+    else free(rle->spans);
+
+    rle->spans = nullptr;
+    rle->alloc = 0;
+    rle->size = 0;
+}
+
+
 static void _genSpan(SwRleData* rle, SwSpan* spans, uint32_t count)
 {
     auto newSize = rle->size + count;
@@ -147,10 +310,7 @@ static void _genSpan(SwRleData* rle, SwSpan* spans, uint32_t count)
     /* allocate enough memory for new spans */
     /* alloc is required to prevent free and reallocation */
     /* when the rle needs to be regenerated because of attribute change. */
-    if (rle->alloc < newSize) {
-        rle->alloc = (newSize * 2);
-        rle->spans = static_cast<SwSpan*>(realloc(rle->spans, rle->alloc * sizeof(SwSpan)));
-    }
+    if (!_growSpans(rle, newSize)) return;
 
     //copy the new spans to the allocated memory
     SwSpan* lastSpan = rle->spans + rle->size;
@@ -195,7 +355,6 @@ static void _horizLine(RleWorker& rw, SwCoord x, SwCoord y, SwCoord area, SwCoor
     }
 
     if (coverage > 0) {
-        if (!rw.antiAlias) coverage = 255;
         auto count = rw.spansCnt;
         auto span = rw.spans + count - 1;
 
@@ -246,12 +405,22 @@ static void _horizLine(RleWorker& rw, SwCoord x, SwCoord y, SwCoord area, SwCoor
 
 static void _sweep(RleWorker& rw)
 {
-    if (rw.cellsCnt == 0) return;
+    auto rows = rw.rle->rows ? (rw.rle->rows + (rw.cellMin.y - rw.rle->yMin)) : nullptr;
+
+    if (rw.cellsCnt == 0 && rw.block == 0) {
+        if (rows) {
+            for (int y = 0; y < rw.yCnt; ++y) rows[y] = rw.rle->size;
+        }
+        return;
+    }
 
     rw.spansCnt = 0;
     rw.ySpan = 0;
 
     for (int y = 0; y < rw.yCnt; ++y) {
+        //Index of the first span of the row, including the pending ones
+        if (rows) rows[y] = rw.rle->size + rw.spansCnt;
+
         auto cover = 0;
         auto x = 0;
         auto cell = rw.yCells[y];
@@ -274,6 +443,49 @@ static void _sweep(RleWorker& rw)
 }
 
 
+//Dense counterpart of _sweep(): the cover is integrated along the rows in one pass
+static void _sweepAccum(RleWorker& rw)
+{
+    auto rows = rw.rle->rows ? (rw.rle->rows + (rw.cellMin.y - rw.rle->yMin)) : nullptr;
+
+    if (rw.cellsCnt == 0) {
+        if (rows) {
+            for (int y = 0; y < rw.yCnt; ++y) rows[y] = rw.rle->size;
+        }
+        return;
+    }
+
+    rw.spansCnt = 0;
+    rw.ySpan = 0;
+
+    for (int y = 0; y < rw.yCnt; ++y) {
+        //Index of the first span of the row, including the pending ones
+        if (rows) rows[y] = rw.rle->size + rw.spansCnt;
+
+        auto areas = rw.areas + y * rw.stride + 1;
+        auto covers = rw.covers + y * rw.stride + 1;
+        SwCoord cover = covers[-1];
+
+        /* Pixels of the same area are emitted as one line. Coverage is computed per
+           pixel exactly as the cell sweep does, so the spans are the same. */
+        Area run = 0;
+        SwCoord runX = 0;
+
+        for (SwCoord x = 0; x < rw.cellXCnt; ++x) {
+            cover += covers[x];
+            auto area = cover * (ONE_PIXEL * 2) - areas[x];
+            if (area == run) continue;
+            if (run != 0) _horizLine(rw, runX, y, run, x - runX);
+            run = area;
+            runX = x;
+        }
+        if (run != 0) _horizLine(rw, runX, y, run, rw.cellXCnt - runX);
+    }
+
+    if (rw.spansCnt > 0) _genSpan(rw.rle, rw.spans, rw.spansCnt);
+}
+
+
 static Cell* _findCell(RleWorker& rw)
 {
     auto x = rw.cellPos.x;
@@ -288,7 +500,16 @@ static Cell* _findCell(RleWorker& rw)
         pcell = &cell->next;
     }
 
-    if (rw.cellsCnt >= rw.maxCells) longjmp(rw.jmpBuf, 1);
+    //Continue in the next block of the arena
+    if (rw.cellsCnt >= rw.maxCells) {
+        if (++rw.block == arena.blocks.size()) {
+            auto block = static_cast<Cell*>(malloc(ARENA_BLOCK_CELLS * sizeof(Cell)));
+            if (!block) longjmp(rw.jmpBuf, 1);
+            arena.blocks.push_back(block);
+        }
+        rw.cells = arena.blocks[rw.block];
+        rw.cellsCnt = 0;
+    }
 
     auto cell = rw.cells + rw.cellsCnt++;
     cell->x = x;
@@ -304,6 +525,15 @@ static Cell* _findCell(RleWorker& rw)
 static void _recordCell(RleWorker& rw)
 {
     if (rw.area | rw.cover) {
+        if (rw.areas) {
+            auto x = rw.cellPos.x;
+            if (x > rw.cellXCnt) x = rw.cellXCnt;
+            auto idx = rw.cellPos.y * rw.stride + x + 1;
+            rw.areas[idx] += rw.area;
+            rw.covers[idx] += rw.cover;
+            ++rw.cellsCnt;
+            return;
+        }
         auto cell = _findCell(rw);
         cell->area += rw.area;
         cell->cover += rw.cover;
@@ -618,27 +848,79 @@ static int _genRle(RleWorker& rw)
 }
 
 
+static bool _prepareBand(RleWorker& rw, const Band* band)
+{
+    rw.yCnt = band->max - band->min;
+
+    if (rw.accumulate) {
+        auto cnt = static_cast<uint32_t>(rw.yCnt * rw.stride);
+        if (arena.accumCnt < cnt) {
+            auto areas = static_cast<Area*>(realloc(arena.areas, cnt * sizeof(Area)));
+            if (!areas) return false;
+            arena.areas = areas;
+            auto covers = static_cast<SwCoord*>(realloc(arena.covers, cnt * sizeof(SwCoord)));
+            if (!covers) return false;
+            arena.covers = covers;
+            arena.accumCnt = cnt;
+        }
+        rw.areas = arena.areas;
+        rw.covers = arena.covers;
+        memset(rw.areas, 0, cnt * sizeof(Area));
+        memset(rw.covers, 0, cnt * sizeof(SwCoord));
+        rw.cellsCnt = 0;
+        return true;
+    }
+
+    if (arena.yCellsCnt < rw.yCnt) {
+        auto yCells = static_cast<Cell**>(realloc(arena.yCells, rw.yCnt * sizeof(Cell*)));
+        if (!yCells) return false;
+        arena.yCells = yCells;
+        arena.yCellsCnt = rw.yCnt;
+    }
+    if (arena.blocks.empty()) {
+        auto block = static_cast<Cell*>(malloc(ARENA_BLOCK_CELLS * sizeof(Cell)));
+        if (!block) return false;
+        arena.blocks.push_back(block);
+    }
+
+    rw.yCells = arena.yCells;
+    for (int y = 0; y < rw.yCnt; ++y)
+        rw.yCells[y] = nullptr;
 
-/************************************************************************/
-/* External Class Implementation                                        */
-/************************************************************************/
+    rw.cells = arena.blocks[0];
+    rw.maxCells = ARENA_BLOCK_CELLS;
+    rw.cellsCnt = 0;
+    rw.block = 0;
 
-SwRleData* rleRender(const SwOutline* outline, const SwBBox& bbox, const SwSize& clip, bool antiAlias)
+    return true;
+}
+
+
+//Would the band have overflowed the former fixed render pool?
+static bool _bandShoot(const RleWorker& rw)
+{
+    constexpr auto LEGACY_POOL_SIZE = 16384L;
+
+    auto cells = static_cast<long>(rw.block) * ARENA_BLOCK_CELLS + rw.cellsCnt;
+    auto available = (LEGACY_POOL_SIZE - static_cast<long>(sizeof(Cell*)) * rw.yCnt) / static_cast<long>(sizeof(Cell));
+    return cells > available;
+}
+
+
+//Generate the spans of the rows [yMin, yMax) into rle
+static bool _render(const SwOutline* outline, const SwBBox& bbox, const SwSize& clip, bool accumulate, SwCoord yMin, SwCoord yMax, SwRleData* rle)
 {
-    constexpr auto RENDER_POOL_SIZE = 16384L;
     constexpr auto BAND_SIZE = 40;
+    constexpr auto BAND_HEIGHT = 64;
 
-    //TODO: We can preserve several static workers in advance
     RleWorker rw;
-    Cell buffer[RENDER_POOL_SIZE / sizeof(Cell)];
 
     //Init Cells
-    rw.buffer = buffer;
-    rw.bufferSize = sizeof(buffer);
-    rw.yCells = reinterpret_cast<Cell**>(buffer);
+    rw.yCells = nullptr;
     rw.cells = nullptr;
     rw.maxCells = 0;
     rw.cellsCnt = 0;
+    rw.block = 0;
     rw.area = 0;
     rw.cover = 0;
     rw.invalid = true;
@@ -648,28 +930,28 @@ SwRleData* rleRender(const SwOutline* outline, const SwBBox& bbox, const SwSize&
     rw.cellYCnt = rw.cellMax.y - rw.cellMin.y;
     rw.ySpan = 0;
     rw.outline = const_cast<SwOutline*>(outline);
-    rw.bandSize = rw.bufferSize / (sizeof(Cell) * 8);  //bandSize: 64
-    rw.bandShoot = 0;
     rw.clip = clip;
-    rw.antiAlias = antiAlias;
-    rw.rle = reinterpret_cast<SwRleData*>(calloc(1, sizeof(SwRleData)));
+    rw.accumulate = accumulate;
+    rw.areas = nullptr;
+    rw.covers = nullptr;
+    rw.stride = rw.cellXCnt + 2;
+    rw.rle = rle;
 
     //Generate RLE
     Band bands[BAND_SIZE];
     Band* band;
 
     /* set up vertical bands */
-    auto bandCnt = static_cast<int>((rw.cellMax.y - rw.cellMin.y) / rw.bandSize);
+    auto bandCnt = static_cast<int>((yMax - yMin) / BAND_HEIGHT);
     if (bandCnt == 0) bandCnt = 1;
     else if (bandCnt >= BAND_SIZE) bandCnt = (BAND_SIZE - 1);
 
-    auto min = rw.cellMin.y;
-    auto yMax = rw.cellMax.y;
+    auto min = yMin;
     SwCoord max;
     int ret;
 
     for (int n = 0; n < bandCnt; ++n, min = max) {
-        max = min + rw.bandSize;
+        max = min + BAND_HEIGHT;
         if (n == bandCnt -1 || max > yMax) max = yMax;
 
         bands[0].min = min;
@@ -677,29 +959,8 @@ SwRleData* rleRender(const SwOutline* outline, const SwBBox& bbox, const SwSize&
         band = bands;
 
         while (band >= bands) {
-            rw.yCells = static_cast<Cell**>(rw.buffer);
-            rw.yCnt = band->max - band->min;
-
-            int cellStart = sizeof(Cell*) * (int)rw.yCnt;
-            int cellMod = cellStart % sizeof(Cell);
-
-            if (cellMod > 0) cellStart += sizeof(Cell) - cellMod;
-
-            auto cellEnd = rw.bufferSize;
-            cellEnd -= cellEnd % sizeof(Cell);
-
-            auto cellsMax = reinterpret_cast<Cell*>((char*)rw.buffer + cellEnd);
-            rw.cells = reinterpret_cast<Cell*>((char*)rw.buffer + cellStart);
-
-            if (rw.cells >= cellsMax) goto reduce_bands;
-
-            rw.maxCells = cellsMax - rw.cells;
-            if (rw.maxCells < 2) goto reduce_bands;
-
-            for (int y = 0; y < rw.yCnt; ++y)
-                rw.yCells[y] = nullptr;
+            if (!_prepareBand(rw, band)) goto reduce_bands;
 
-            rw.cellsCnt = 0;
             rw.invalid = true;
             rw.cellMin.y = band->min;
             rw.cellMax.y = band->max;
@@ -707,24 +968,29 @@ SwRleData* rleRender(const SwOutline* outline, const SwBBox& bbox, const SwSize&
 
             ret = _genRle(rw);
             if (ret == 0) {
-                _sweep(rw);
+                if (accumulate) {
+                    _sweepAccum(rw);
+                } else {
+                    if (_bandShoot(rw)) ++bandShoots;
+                    _sweep(rw);
+                }
                 --band;
                 continue;
             } else if (ret == 1) {
-                goto error;
+                return false;
             }
 
         reduce_bands:
-            /* render pool overflow: we will reduce the render band by half */
+            /* out of memory: we will reduce the render band by half */
             auto bottom = band->min;
             auto top = band->max;
             auto middle = bottom + ((top - bottom) >> 1);
 
             /* This is too complex for a single scanline; there must
                be some problems */
-            if (middle == bottom) goto error;
+            if (middle == bottom) return false;
 
-            if (bottom - top >= rw.bandSize) ++rw.bandShoot;
+            ++bandShoots;
 
             band[1].min = bottom;
             band[1].max = middle;
@@ -734,21 +1000,1367 @@ SwRleData* rleRender(const SwOutline* outline, const SwBBox& bbox, const SwSize&
         }
     }
 
-    if (rw.bandShoot > 8 && rw.bandSize > 16)
-        rw.bandSize = (rw.bandSize >> 1);
+    return true;
+}
 
-    return rw.rle;
 
-error:
-    free(rw.rle);
-    rw.rle = nullptr;
-    return nullptr;
+/* Aliased shapes are sampled at the pixel centers. The edges are cut at the center
+   line of each row, and the pixels between the crossings are filled by the fill rule. */
+struct Crossing
+{
+    SwCoord x;
+    int32_t dir;
+};
+
+struct AliasArena
+{
+    vector<SwPoint> edges;           //pairs of points, top to bottom
+    vector<int32_t> dirs;
+    vector<uint32_t> rows;           //first crossing of the rows
+    vector<Crossing> crossings;
+};
+
+//Kept for the next renders of the thread
+static thread_local AliasArena aliasArena;
+
+
+static void _aliasLine(AliasArena& arena, const SwPoint& from, const SwPoint& to)
+{
+    if (from.y == to.y) return;
+
+    if (from.y < to.y) {
+        arena.edges.push_back(from);
+        arena.edges.push_back(to);
+        arena.dirs.push_back(1);
+    } else {
+        arena.edges.push_back(to);
+        arena.edges.push_back(from);
+        arena.dirs.push_back(-1);
+    }
 }
 
 
-void rleFree(SwRleData* rle)
+static void _aliasCubic(AliasArena& arena, const SwPoint& from, const SwPoint& ctrl1, const SwPoint& ctrl2, const SwPoint& to)
 {
-    if (!rle) return;
-    if (rle->spans) free(rle->spans);
-    free(rle);
+    constexpr auto TOLERANCE = 16;   //a quarter of pixel
+    constexpr auto MAX_SEGMENTS = 256;
+
+    //Every subdivision divides the deviation from a straight line by 4
+    auto dev = max(max(abs(from.x - 2 * ctrl1.x + ctrl2.x), abs(from.y - 2 * ctrl1.y + ctrl2.y)),
+                   max(abs(ctrl1.x - 2 * ctrl2.x + to.x), abs(ctrl1.y - 2 * ctrl2.y + to.y)));
+
+    auto n = 1;
+    while (dev > TOLERANCE && n < MAX_SEGMENTS) {
+        dev >>= 2;
+        n <<= 1;
+    }
+
+    auto prev = from;
+    for (auto i = 1; i < n; ++i) {
+        auto t = static_cast<float>(i) / n;
+        auto mt = 1.0f - t;
+        auto a = mt * mt * mt;
+        auto b = 3.0f * mt * mt * t;
+        auto c = 3.0f * mt * t * t;
+        auto d = t * t * t;
+        SwPoint pt = {static_cast<SwCoord>(a * from.x + b * ctrl1.x + c * ctrl2.x + d * to.x),
+                      static_cast<SwCoord>(a * from.y + b * ctrl1.y + c * ctrl2.y + d * to.y)};
+        _aliasLine(arena, prev, pt);
+        prev = pt;
+    }
+    _aliasLine(arena, prev, to);
+}
+
+
+static bool _aliasOutline(AliasArena& arena, const SwOutline* outline)
+{
+    uint32_t first = 0;
+
+    for (uint32_t n = 0; n < outline->cntrsCnt; ++n) {
+        auto last = outline->cntrs[n];
+        auto limit = outline->pts + last;
+        SwPoint start = outline->pts[first];
+        auto pt = outline->pts + first;
+        auto types = outline->types + first;
+
+        //A contour cannot start with a cubic control point!
+        if (types[0] == SW_CURVE_TYPE_CUBIC) return false;
+
+        auto closed = false;
+
+        while (pt < limit) {
+            ++pt;
+            ++types;
+
+            if (types[0] == SW_CURVE_TYPE_POINT) {
+                _aliasLine(arena, pt[-1], *pt);
+            } else {
+                if (pt + 1 > limit || types[1] != SW_CURVE_TYPE_CUBIC) return false;
+
+                pt += 2;
+                types += 2;
+
+                if (pt <= limit) {
+                    _aliasCubic(arena, pt[-3], pt[-2], pt[-1], pt[0]);
+                    continue;
+                }
+                _aliasCubic(arena, pt[-3], pt[-2], pt[-1], start);
+                closed = true;
+                break;
+            }
+        }
+        if (!closed) _aliasLine(arena, *limit, start);
+        first = last + 1;
+    }
+    return true;
+}
+
+
+//Generate the whole pixel spans of the rows [bbox.min.y, bbox.max.y) into rle
+static bool _renderAliased(const SwOutline* outline, const SwBBox& bbox, const SwSize& clip, SwRleData* rle)
+{
+    auto& arena = aliasArena;
+    arena.edges.clear();
+    arena.dirs.clear();
+
+    if (!_aliasOutline(arena, outline)) return false;
+
+    //The visible rows
+    auto yMin = max(bbox.min.y, static_cast<SwCoord>(0));
+    auto yMax = min(bbox.max.y, clip.h);
+    auto rowCnt = (yMax > yMin) ? (yMax - yMin) : 0;
+
+    //Count the crossings of the row center lines: y * 64 + 32 in [top, bottom)
+    arena.rows.assign(rowCnt + 1, 0);
+    auto edgeCnt = arena.dirs.size();
+
+    for (uint32_t i = 0; i < edgeCnt; ++i) {
+        auto& top = arena.edges[i * 2];
+        auto& bottom = arena.edges[i * 2 + 1];
+        auto y1 = max((top.y + 31) >> 6, yMin);
+        auto y2 = min((bottom.y + 31) >> 6, yMax);
+        for (auto y = y1; y < y2; ++y) ++arena.rows[y - yMin + 1];
+    }
+    for (SwCoord y = 0; y < rowCnt; ++y) arena.rows[y + 1] += arena.rows[y];
+
+    arena.crossings.resize(arena.rows[rowCnt]);
+    for (uint32_t i = 0; i < edgeCnt; ++i) {
+        auto& top = arena.edges[i * 2];
+        auto& bottom = arena.edges[i * 2 + 1];
+        auto y1 = max((top.y + 31) >> 6, yMin);
+        auto y2 = min((bottom.y + 31) >> 6, yMax);
+        auto dx = static_cast<int64_t>(bottom.x - top.x);
+        auto dy = static_cast<int64_t>(bottom.y - top.y);
+        for (auto y = y1; y < y2; ++y) {
+            auto center = y * 64 + 32;
+            auto& crossing = arena.crossings[arena.rows[y - yMin]++];
+            crossing.x = top.x + static_cast<SwCoord>((center - top.y) * dx / dy);
+            crossing.dir = arena.dirs[i];
+        }
+    }
+
+    //The fill moved the starts to the next rows
+    for (auto y = rowCnt; y > 0; --y) arena.rows[y] = arena.rows[y - 1];
+    arena.rows[0] = 0;
+
+    auto evenOdd = (outline->fillMode == SW_OUTLINE_FILL_EVEN_ODD);
+    auto rows = rle->rows;
+
+    for (auto y = bbox.min.y; y < bbox.max.y; ++y) {
+        if (rows) rows[y - rle->yMin] = rle->size;
+        if (y < yMin || y >= yMax) continue;
+
+        auto begin = arena.crossings.data() + arena.rows[y - yMin];
+        auto end = arena.crossings.data() + arena.rows[y - yMin + 1];
+        sort(begin, end, [](const Crossing& a, const Crossing& b) { return a.x < b.x; });
+
+        auto winding = 0;
+        for (auto crossing = begin; crossing < end - 1; ++crossing) {
+            winding += crossing->dir;
+            if (evenOdd ? !(winding & 1) : (winding == 0)) continue;
+
+            //Pixels of the centers in [crossing.x, next.x)
+            auto x1 = max((crossing->x + 31) >> 6, static_cast<SwCoord>(0));
+            auto x2 = min((crossing[1].x + 31) >> 6, clip.w);
+            if (x1 >= x2) continue;
+
+            //Continue the last span of the row?
+            auto last = (rle->size > 0) ? rle->spans + rle->size - 1 : nullptr;
+            if (last && last->y == y && last->x + last->len == x1) {
+                last->len += static_cast<uint16_t>(x2 - x1);
+                continue;
+            }
+            if (!_growSpans(rle, rle->size + 1)) return false;
+            auto span = rle->spans + rle->size++;
+            span->x = static_cast<int16_t>(x1);
+            span->y = static_cast<int16_t>(y);
+            span->len = static_cast<uint16_t>(x2 - x1);
+            span->coverage = 255;
+        }
+    }
+
+    return true;
+}
+
+
+/* Hairlines are too thin for the stroker to pay off. Each segment of the path marks
+   the coverage of the pixels around it, the box filtered overlap of the pixel with
+   the line across and along it, and the overlapping segments keep the larger one. */
+struct HairSegment
+{
+    Point p1, p2;
+    float ext1, ext2;                //extensions beyond the ends: caps and joins
+    float yMin, yMax;                //reach of the segment, in pixels
+};
+
+struct HairRun
+{
+    SwCoord x1, x2;
+};
+
+struct HairlineArena
+{
+    vector<HairSegment> segments;
+    vector<uint8_t> covers;          //a band of rows of the visible width, zeroed between the renders
+    vector<SwCoord> dirty;           //the touched columns [min, max) of the band rows by a segment
+    vector<vector<HairRun>> runs;    //the touched columns of the band rows, the spans are generated from
+};
+
+//Kept for the next renders of the thread
+static thread_local HairlineArena hairlineArena;
+
+//Coverage buffer size of a band
+constexpr auto HAIRLINE_BAND_SIZE = 1 << 16;
+
+
+static void _hairLine(HairlineArena& arena, const Point& p1, const Point& p2, float ext1, float ext2, float hw)
+{
+    if (p1.x == p2.x && p1.y == p2.y) return;
+
+    auto reach = max(ext1, ext2) + hw + 1.0f;
+    arena.segments.push_back({p1, p2, ext1, ext2, min(p1.y, p2.y) - reach, max(p1.y, p2.y) + reach});
+}
+
+
+static void _hairCubic(vector<Point>& pts, const SwPoint& from, const SwPoint& ctrl1, const SwPoint& ctrl2, const SwPoint& to)
+{
+    constexpr auto TOLERANCE = 4;    //a sixteenth of pixel
+    constexpr auto MAX_SEGMENTS = 256;
+
+    //Every subdivision divides the deviation from a straight line by 4
+    auto dev = max(max(abs(from.x - 2 * ctrl1.x + ctrl2.x), abs(from.y - 2 * ctrl1.y + ctrl2.y)),
+                   max(abs(ctrl1.x - 2 * ctrl2.x + to.x), abs(ctrl1.y - 2 * ctrl2.y + to.y)));
+
+    auto n = 1;
+    while (dev > TOLERANCE && n < MAX_SEGMENTS) {
+        dev >>= 2;
+        n <<= 1;
+    }
+
+    for (auto i = 1; i < n; ++i) {
+        auto t = static_cast<float>(i) / n;
+        auto mt = 1.0f - t;
+        auto a = mt * mt * mt;
+        auto b = 3.0f * mt * mt * t;
+        auto c = 3.0f * mt * t * t;
+        auto d = t * t * t;
+        pts.push_back({(a * from.x + b * ctrl1.x + c * ctrl2.x + d * to.x) / 64.0f, (a * from.y + b * ctrl1.y + c * ctrl2.y + d * to.y) / 64.0f});
+    }
+    pts.push_back({to.x / 64.0f, to.y / 64.0f});
+}
+
+
+//Flatten the contours into the segments, which are extended by the caps at the open ends and by the joins between them
+static bool _hairOutline(HairlineArena& arena, const SwOutline* outline, float hw, float cap)
+{
+    vector<Point> pts;
+
+    uint32_t first = 0;
+
+    for (uint32_t n = 0; n < outline->cntrsCnt; ++n) {
+        auto last = outline->cntrs[n];
+        auto limit = outline->pts + last;
+        SwPoint start = outline->pts[first];
+        auto pt = outline->pts + first;
+        auto types = outline->types + first;
+
+        //A contour cannot start with a cubic control point!
+        if (types[0] == SW_CURVE_TYPE_CUBIC) return false;
+
+        pts.clear();
+        pts.push_back({start.x / 64.0f, start.y / 64.0f});
+
+        while (pt < limit) {
+            ++pt;
+            ++types;
+
+            if (types[0] == SW_CURVE_TYPE_POINT) {
+                pts.push_back({pt->x / 64.0f, pt->y / 64.0f});
+            } else {
+                if (pt + 1 > limit || types[1] != SW_CURVE_TYPE_CUBIC) return false;
+
+                pt += 2;
+                types += 2;
+
+                if (pt <= limit) {
+                    _hairCubic(pts, pt[-3], pt[-2], pt[-1], pt[0]);
+                    continue;
+                }
+                _hairCubic(pts, pt[-3], pt[-2], pt[-1], start);
+                break;
+            }
+        }
+        first = last + 1;
+
+        if (!outline->opened) pts.push_back(pts.front());
+
+        auto cnt = pts.size();
+        for (uint32_t i = 1; i < cnt; ++i) {
+            auto ext1 = (i == 1 && outline->opened) ? cap : hw;
+            auto ext2 = (i == cnt - 1 && outline->opened) ? cap : hw;
+            _hairLine(arena, pts[i - 1], pts[i], ext1, ext2, hw);
+        }
+    }
+    return true;
+}
+
+
+//Mark the coverage of the segment on the band of the rows [y1, y2) and the columns [x1, x2)
+static void _hairSegment(HairlineArena& arena, const HairSegment& seg, float hw, SwCoord x1, SwCoord x2, SwCoord y1, SwCoord y2)
+{
+    auto dx = seg.p2.x - seg.p1.x;
+    auto dy = seg.p2.y - seg.p1.y;
+    auto len = sqrtf(dx * dx + dy * dy);
+    auto ux = dx / len;
+    auto uy = dy / len;
+    auto stride = x2 - x1;
+    auto xMajor = fabsf(dx) >= fabsf(dy);
+    auto covers = arena.covers.data();
+    auto dirty = arena.dirty.data();
+
+    //The pixels a segment touches along its major axis, and around the line on the minor one
+    auto e1 = Point{seg.p1.x - ux * seg.ext1, seg.p1.y - uy * seg.ext1};
+    auto e2 = Point{seg.p2.x + ux * seg.ext2, seg.p2.y + uy * seg.ext2};
+    auto reach = (hw + 0.5f) / (xMajor ? fabsf(ux) : fabsf(uy));
+    auto slope = xMajor ? (dy / dx) : (dx / dy);
+
+    SwCoord from, to;
+    if (xMajor) {
+        from = max(static_cast<SwCoord>(floorf(min(e1.x, e2.x) - 1.0f)), x1);
+        to = min(static_cast<SwCoord>(ceilf(max(e1.x, e2.x) + 1.0f)), x2);
+    } else {
+        from = max(static_cast<SwCoord>(floorf(min(e1.y, e2.y) - 1.0f)), y1);
+        to = min(static_cast<SwCoord>(ceilf(max(e1.y, e2.y) + 1.0f)), y2);
+    }
+
+    //The touched rows of a x major segment are collected over its columns
+    SwCoord rowFrom = 0, rowTo = 0;
+    if (xMajor) {
+        rowFrom = max(static_cast<SwCoord>(floorf(min(e1.y, e2.y) - reach - 1.0f)), y1);
+        rowTo = min(static_cast<SwCoord>(ceilf(max(e1.y, e2.y) + reach + 1.0f)), y2);
+        for (auto y = rowFrom; y < rowTo; ++y) {
+            dirty[(y - y1) * 2] = stride;
+            dirty[(y - y1) * 2 + 1] = 0;
+        }
+    }
+
+    for (auto i = from; i < to; ++i) {
+        //The line at the pixel center of the major axis
+        auto center = xMajor ? (seg.p1.y + (i + 0.5f - seg.p1.x) * slope) : (seg.p1.x + (i + 0.5f - seg.p1.y) * slope);
+        auto jFrom = static_cast<SwCoord>(floorf(center - reach - 0.5f));
+        auto jTo = static_cast<SwCoord>(ceilf(center + reach + 0.5f));
+        if (xMajor) {
+            jFrom = max(jFrom, rowFrom);
+            jTo = min(jTo, rowTo);
+        } else {
+            jFrom = max(jFrom, x1);
+            jTo = min(jTo, x2);
+            if (jFrom >= jTo) continue;
+            arena.runs[i - y1].push_back({jFrom - x1, jTo - x1});
+        }
+
+        //Position of the pixel center on the segment: u along and v across, stepped over the minor axis
+        auto px = (xMajor ? i : jFrom) + 0.5f - seg.p1.x;
+        auto py = (xMajor ? jFrom : i) + 0.5f - seg.p1.y;
+        auto u = px * ux + py * uy;
+        auto v = py * ux - px * uy;
+        auto du = xMajor ? uy : ux;
+        auto dv = xMajor ? ux : -uy;
+
+        for (auto j = jFrom; j < jTo; ++j, u += du, v += dv) {
+            auto across = min(v + 0.5f, hw) - max(v - 0.5f, -hw);
+            if (across <= 0.0f) continue;
+            auto along = min(min(u + 0.5f, len + seg.ext2) - max(u - 0.5f, -seg.ext1), 1.0f);
+            if (along <= 0.0f) continue;
+
+            auto coverage = static_cast<uint8_t>(across * along * 255.0f + 0.5f);
+            auto x = (xMajor ? i : j) - x1;
+            auto y = (xMajor ? j : i) - y1;
+            auto& cover = covers[y * stride + x];
+            if (coverage > cover) cover = coverage;
+            if (xMajor) {
+                auto row = dirty + y * 2;
+                if (x < row[0]) row[0] = x;
+                if (x >= row[1]) row[1] = x + 1;
+            }
+        }
+    }
+
+    for (auto y = rowFrom; y < rowTo; ++y) {
+        auto row = dirty + (y - y1) * 2;
+        if (row[0] < row[1]) arena.runs[y - y1].push_back({row[0], row[1]});
+    }
+}
+
+
+//Generate the spans of the rows [bbox.min.y, bbox.max.y) into rle
+static bool _renderHairline(HairlineArena& arena, const SwBBox& bbox, const SwSize& clip, float hw, SwRleData* rle)
+{
+    auto xMin = max(bbox.min.x, static_cast<SwCoord>(0));
+    auto xMax = min(bbox.max.x, clip.w);
+    auto yMin = max(bbox.min.y, static_cast<SwCoord>(0));
+    auto yMax = min(bbox.max.y, clip.h);
+    auto rows = rle->rows;
+
+    for (auto y = bbox.min.y; y < yMin; ++y) rows[y - rle->yMin] = 0;
+
+    if (xMin < xMax && yMin < yMax) {
+        auto w = xMax - xMin;
+        auto bandH = min(max(HAIRLINE_BAND_SIZE / w, static_cast<SwCoord>(1)), yMax - yMin);
+
+        //The coverage buffer is cleared behind the spans generation, only the dirty columns of the rows are visited
+        if (arena.covers.size() < static_cast<size_t>(w * bandH)) {
+            arena.covers.assign(w * bandH, 0);
+        }
+        arena.dirty.resize(bandH * 2);
+        if (arena.runs.size() < static_cast<size_t>(bandH)) arena.runs.resize(bandH);
+
+        for (auto y1 = yMin; y1 < yMax; y1 += bandH) {
+            auto y2 = min(y1 + bandH, yMax);
+
+            for (auto y = y1; y < y2; ++y) arena.runs[y - y1].clear();
+            for (auto& seg : arena.segments) {
+                if (seg.yMax < y1 || seg.yMin >= y2) continue;
+                _hairSegment(arena, seg, hw, xMin, xMax, y1, y2);
+            }
+            //Runs of the same coverage in the touched columns make the spans
+            for (auto y = y1; y < y2; ++y) {
+                rows[y - rle->yMin] = rle->size;
+                auto covers = arena.covers.data() + (y - y1) * w;
+                auto& runs = arena.runs[y - y1];
+                sort(runs.begin(), runs.end(), [](const HairRun& a, const HairRun& b) { return a.x1 < b.x1; });
+                auto run = runs.data();
+                auto runEnd = run + runs.size();
+
+                while (run < runEnd) {
+                    //Merge the overlapping runs
+                    auto x = run->x1;
+                    auto end = run->x2;
+                    for (++run; run < runEnd && run->x1 <= end; ++run) {
+                        if (run->x2 > end) end = run->x2;
+                    }
+                    while (x < end) {
+                        auto coverage = covers[x];
+                        auto x0 = x;
+                        while (++x < end && covers[x] == coverage);
+                        if (coverage == 0) continue;
+                        memset(covers + x0, 0, x - x0);
+                        //Continue the last span of the row?
+                        auto last = (rle->size > 0) ? rle->spans + rle->size - 1 : nullptr;
+                        if (last && last->y == y && last->x + last->len == xMin + x0 && last->coverage == coverage) {
+                            last->len += static_cast<uint16_t>(x - x0);
+                            continue;
+                        }
+                        if (!_growSpans(rle, rle->size + 1)) {
+                            arena.covers.clear();
+                            return false;
+                        }
+                        auto span = rle->spans + rle->size++;
+                        span->x = static_cast<int16_t>(xMin + x0);
+                        span->y = static_cast<int16_t>(y);
+                        span->len = static_cast<uint16_t>(x - x0);
+                        span->coverage = coverage;
+                    }
+                }
+            }
+        }
+    }
+
+    for (auto y = max(yMax, bbox.min.y); y < bbox.max.y; ++y) rows[y - rle->yMin] = rle->size;
+
+    return true;
+}
+
+
+/* Large shapes are split into row chunks rendered on the workers.
+   Spans never merge across bands, so the concatenated chunks are identical to a serial run. */
+constexpr auto MAX_RLE_CHUNKS = 32;
+
+struct RleJob
+{
+    const SwOutline* outline;
+    SwBBox bbox;
+    SwSize clip;
+    bool accumulate;
+
+    SwRleData rles[MAX_RLE_CHUNKS];
+    SwCoord chunkSize;
+    uint32_t cnt;
+
+    atomic<uint32_t> next{0};
+    uint32_t done = 0;
+    bool failed = false;
+    mutex mtx;
+    condition_variable finished;
+};
+
+
+static void _renderChunks(RleJob& job)
+{
+    uint32_t i;
+    while ((i = job.next++) < job.cnt) {
+        auto min = job.bbox.min.y + job.chunkSize * i;
+        auto max = (i == job.cnt - 1) ? job.bbox.max.y : min + job.chunkSize;
+        auto ret = _render(job.outline, job.bbox, job.clip, job.accumulate, min, max, &job.rles[i]);
+
+        unique_lock<mutex> lock{job.mtx};
+        if (!ret) job.failed = true;
+        if (++job.done == job.cnt) job.finished.notify_all();
+    }
+}
+
+
+struct RleTask : Task
+{
+    shared_ptr<RleJob> job;
+
+    void run() override
+    {
+        //Might be picked up after the job was finished by the others, it's harmless.
+        _renderChunks(*job);
+        job.reset();
+    }
+};
+
+
+//Idle helpers are the ones whose previous request has finished
+static vector<RleTask*> helpers;
+static mutex helpersMtx;
+
+
+static void _requestHelpers(const shared_ptr<RleJob>& job, uint32_t cnt)
+{
+    unique_lock<mutex> lock{helpersMtx};
+
+    for (auto helper : helpers) {
+        if (cnt == 0) return;
+        if (!helper->ready()) continue;
+        helper->get();
+        helper->job = job;
+        TaskScheduler::request(helper);
+        --cnt;
+    }
+    for (; cnt > 0; --cnt) {
+        auto helper = new RleTask;
+        helper->job = job;
+        helpers.push_back(helper);
+        TaskScheduler::request(helper);
+    }
+}
+
+
+/* Boolean operations of two rle data, row by row.
+   Coverages are combined per pixel, so anti-aliased edges stay smooth. */
+static inline uint8_t _multiply(uint8_t c, uint8_t a)
+{
+    //exact for the full coverage
+    return static_cast<uint8_t>((c * a + 0xff) >> 8);
+}
+
+
+struct RleIntersect
+{
+    static uint8_t coverage(uint8_t lhs, uint8_t rhs) { return _multiply(lhs, rhs); }
+};
+
+
+struct RleUnion
+{
+    static uint8_t coverage(uint8_t lhs, uint8_t rhs) { return lhs + rhs - _multiply(lhs, rhs); }
+};
+
+
+struct RleSubtract
+{
+    static uint8_t coverage(uint8_t lhs, uint8_t rhs) { return _multiply(lhs, 255 - rhs); }
+};
+
+
+static void _emitSpan(SwRleData* out, SwCoord x, SwCoord y, SwCoord len, uint8_t coverage)
+{
+    //Continue the last span?
+    if (out->size > 0) {
+        auto last = out->spans + out->size - 1;
+        if (last->y == y && last->x + last->len == x && last->coverage == coverage) {
+            last->len += len;
+            return;
+        }
+    }
+    if (!_growSpans(out, out->size + 1)) return;
+
+    auto span = out->spans + out->size;
+    span->x = x;
+    span->y = y;
+    span->len = len;
+    span->coverage = coverage;
+    ++out->size;
+}
+
+
+template<typename Op>
+static void _mergeRow(const SwSpan* l, const SwSpan* le, const SwSpan* r, const SwSpan* re, SwCoord y, SwRleData* out)
+{
+    SwCoord x = LONG_MAX;
+    if (l < le) x = l->x;
+    if (r < re && r->x < x) x = r->x;
+
+    //Visit the intervals between the span edges of both rows
+    while (l < le || r < re) {
+        uint8_t lc = 0;
+        uint8_t rc = 0;
+        SwCoord next = LONG_MAX;
+
+        if (l < le) {
+            if (l->x <= x) {
+                lc = l->coverage;
+                if (l->x + l->len < next) next = l->x + l->len;
+            } else if (l->x < next) {
+                next = l->x;
+            }
+        }
+        if (r < re) {
+            if (r->x <= x) {
+                rc = r->coverage;
+                if (r->x + r->len < next) next = r->x + r->len;
+            } else if (r->x < next) {
+                next = r->x;
+            }
+        }
+
+        auto coverage = Op::coverage(lc, rc);
+        if (coverage > 0) _emitSpan(out, x, y, next - x, coverage);
+
+        x = next;
+        if (l < le && l->x + l->len <= x) ++l;
+        if (r < re && r->x + r->len <= x) ++r;
+    }
+}
+
+
+template<typename Op>
+static bool _merge(const SwRleData* lhs, const SwRleData* rhs, SwRleData* out)
+{
+    out->size = 0;
+
+    auto l = (lhs && lhs->size > 0) ? lhs->spans : nullptr;
+    auto le = l ? (l + lhs->size) : nullptr;
+    auto r = (rhs && rhs->size > 0) ? rhs->spans : nullptr;
+    auto re = r ? (r + rhs->size) : nullptr;
+
+    //The rows of the result
+    SwCoord yMin = LONG_MAX;
+    SwCoord yMax = LONG_MIN;
+    if (l) {
+        yMin = l->y;
+        yMax = (le - 1)->y + 1;
+    }
+    if (r) {
+        if (r->y < yMin) yMin = r->y;
+        if ((re - 1)->y + 1 > yMax) yMax = (re - 1)->y + 1;
+    }
+    if (yMin >= yMax) yMin = yMax = 0;
+
+    out->yMin = yMin;
+    if (!_growRows(out, yMax - yMin)) return false;
+
+    for (auto y = yMin; y < yMax; ++y) {
+        out->rows[y - yMin] = out->size;
+
+        auto lr = l;
+        while (l && l < le && l->y == y) ++l;
+        auto rr = r;
+        while (r && r < re && r->y == y) ++r;
+
+        _mergeRow<Op>(lr, l, rr, r, y, out);
+    }
+    out->rows[out->rowCnt] = out->size;
+
+    return true;
+}
+
+
+//The result replaces the lhs, its former memory is released
+template<typename Op>
+static bool _mergeInPlace(SwRleData* lhs, const SwRleData* rhs)
+{
+    if (!lhs) return false;
+
+    SwRleData merged = {nullptr, 0, 0, lhs->pool, nullptr, 0, 0, 0};
+    auto ret = _merge<Op>(lhs, rhs, &merged);
+    if (ret) swap(*lhs, merged);
+
+    _freeSpans(&merged);
+    if (merged.rows) free(merged.rows);
+
+    return ret;
+}
+
+
+static uint32_t _chunkCnt(const SwOutline* outline, const SwBBox& bbox)
+{
+    constexpr auto MIN_CHUNK_HEIGHT = 256;
+    constexpr auto MIN_DENSE_CHUNK_HEIGHT = 128;
+    constexpr auto DENSE_POINTS = 2048;
+
+    auto threads = TaskScheduler::threads();
+    if (threads == 0) return 1;
+
+    //Complex outlines are worth splitting earlier
+    auto height = bbox.max.y - bbox.min.y;
+    auto cnt = height / ((outline->ptsCnt >= DENSE_POINTS) ? MIN_DENSE_CHUNK_HEIGHT : MIN_CHUNK_HEIGHT);
+
+    //The caller takes a chunk as well
+    if (cnt > threads + 1) cnt = threads + 1;
+    if (cnt > MAX_RLE_CHUNKS) cnt = MAX_RLE_CHUNKS;
+    if (cnt < 2) return 1;
+    return cnt;
+}
+
+
+/* Rectangles, rounded rectangles and ellipses are covered analytically. A row is cut
+   at the horizontal edges and the ends of the corners: the straight bands are covered
+   by their extent exactly, and the bands of the corners are sampled. */
+constexpr auto ROUND_RECT_SAMPLES = 16;
+constexpr auto ROUND_RECT_DRIFT = 0.125f;
+constexpr auto ROUND_RECT_MAX_SAMPLES = 1024;
+
+struct RoundRectZone
+{
+    SwCoord min, max;                //the pixels an end of the extents fell in
+};
+
+struct RoundRectArena
+{
+    vector<float> covers;            //coverage of the pixels the extents end in
+    vector<float> deltas;            //coverage changes of the whole pixels
+};
+
+//Kept for the next renders of the thread
+static thread_local RoundRectArena roundRectArena;
+
+
+//Horizontal distance of the corners from the vertical edges at y
+static float _roundRectInset(const SwRoundRect& rr, float y)
+{
+    if (rr.rx <= 0.0f || rr.ry <= 0.0f) return 0.0f;
+
+    //Depth of y in the corner, from 0 at the horizontal edge to 1 at the vertical one
+    auto v = 1.0f;
+    if (y < rr.y1 + rr.ry) v = (y - rr.y1) / rr.ry;
+    else if (y > rr.y2 - rr.ry) v = (rr.y2 - y) / rr.ry;
+    if (v >= 1.0f) return 0.0f;
+    if (v < 0.0f) v = 0.0f;
+
+    if (rr.bevel) return rr.rx * (1.0f - v);
+
+    /* The corner is the cubic of the outline, from the vertical edge at t = 0 to the horizontal one
+       at t = 1. With s = 1 - t, its depth is s^2 * (a + b * s): Newton's method finds s from a guess
+       below it, three steps are exact in float. */
+    auto a = 3.0f * (1.0f - rr.k);
+    auto b = 1.0f - a;
+    auto s = sqrtf(v / a);
+    for (auto i = 0; i < 3; ++i) {
+        auto d = s * (2.0f * a + 3.0f * b * s);
+        if (d <= 0.0f) break;
+        s -= (s * s * (a + b * s) - v) / d;
+    }
+    if (s > 1.0f) s = 1.0f;
+    auto t = 1.0f - s;
+
+    return rr.rx * t * t * (a * s + t);
+}
+
+
+//Horizontal extent of the rounded rectangle at y
+static bool _roundRectExtent(const SwRoundRect& rr, float y, float& x1, float& x2)
+{
+    if (y < rr.y1 || y >= rr.y2) return false;
+
+    auto inset = _roundRectInset(rr, y);
+    x1 = rr.x1 + inset;
+    x2 = rr.x2 - inset;
+
+    return x1 < x2;
+}
+
+
+//How far the ends of the extents move in [y1, y2], the corners are monotonic between the breaks
+static float _roundRectDrift(const SwRoundRect& rr, float y1, float y2)
+{
+    if (y2 <= rr.y1 || y1 >= rr.y2) return 0.0f;
+    return fabsf(_roundRectInset(rr, max(y1, rr.y1)) - _roundRectInset(rr, min(y2, rr.y2)));
+}
+
+
+static bool _roundRectCurved(const SwRoundRect& rr, float y1, float y2)
+{
+    if (rr.rx <= 0.0f || rr.ry <= 0.0f) return false;
+    return (y1 < rr.y1 + rr.ry && y2 > rr.y1) || (y1 < rr.y2 && y2 > rr.y2 - rr.ry);
+}
+
+
+//Insert the ends of the edges and the corners in (y1, y2) to the sorted breaks
+static void _roundRectBreaks(const SwRoundRect& rr, float y1, float y2, float* breaks, uint32_t& cnt)
+{
+    float ys[] = {rr.y1, rr.y1 + rr.ry, rr.y2 - rr.ry, rr.y2};
+    for (auto y : ys) {
+        if (y <= y1 || y >= y2) continue;
+        auto i = cnt++;
+        for (; i > 0 && breaks[i - 1] > y; --i) breaks[i] = breaks[i - 1];
+        breaks[i] = y;
+    }
+}
+
+
+//Accumulate the coverage of [x1, x2) weighted by the band height, and widen the zones of its ends
+static void _roundRectCover(RoundRectArena& arena, float x1, float x2, float weight, SwCoord w, RoundRectZone& zone1, RoundRectZone& zone2)
+{
+    if (x1 < 0.0f) x1 = 0.0f;
+    if (x2 > w) x2 = w;
+    if (x1 >= x2) return;
+
+    auto i1 = static_cast<SwCoord>(x1);
+    auto i2 = static_cast<SwCoord>(x2);
+    auto covers = arena.covers.data();
+
+    if (i1 == i2) {
+        covers[i1] += (x2 - x1) * weight;
+    } else {
+        covers[i1] += (i1 + 1 - x1) * weight;
+        arena.deltas[i1 + 1] += weight;
+        arena.deltas[i2] -= weight;
+        covers[i2] += (x2 - i2) * weight;
+    }
+
+    if (i1 < zone1.min) zone1.min = i1;
+    if (i1 + 1 > zone1.max) zone1.max = i1 + 1;
+    if (i2 < zone2.min) zone2.min = i2;
+    if (i2 > zone2.max) zone2.max = i2;
+}
+
+
+static void _roundRectEmit(SwRleData* rle, SwCoord x, SwCoord y, SwCoord len, float cover)
+{
+    if (len <= 0) return;
+    auto coverage = static_cast<int32_t>(cover * 255.0f + 0.5f);
+    if (coverage <= 0) return;
+    _emitSpan(rle, x, y, len, (coverage > 255) ? 255 : coverage);
+}
+
+
+//Generate the spans of the rows [bbox.min.y, bbox.max.y) into rle
+static void _renderRoundRect(RoundRectArena& arena, const SwRoundRect& outer, const SwRoundRect* inner, const SwBBox& bbox, const SwSize& clip, bool antiAlias, SwRleData* rle)
+{
+    auto xMin = max(bbox.min.x, static_cast<SwCoord>(0));
+    auto xMax = min(bbox.max.x, clip.w);
+    auto yMin = max(bbox.min.y, static_cast<SwCoord>(0));
+    auto yMax = min(bbox.max.y, clip.h);
+    auto rows = rle->rows;
+
+    for (auto y = bbox.min.y; y < yMin; ++y) rows[y - rle->yMin] = 0;
+
+    auto w = xMax - xMin;
+    if (w > 0) {
+        //Two pixels more for the ends at the right edge
+        arena.covers.assign(w + 2, 0.0f);
+        arena.deltas.assign(w + 2, 0.0f);
+    }
+
+    for (auto y = yMin; y < yMax; ++y) {
+        rows[y - rle->yMin] = rle->size;
+        if (w <= 0) continue;
+
+        //Aliased rows are sampled at the pixel centers
+        if (!antiAlias) {
+            float x1, x2, x3, x4;
+            auto cy = y + 0.5f;
+            if (!_roundRectExtent(outer, cy, x1, x4)) continue;
+            auto hole = inner && _roundRectExtent(*inner, cy, x2, x3);
+            if (!hole) x2 = x3 = x4;
+            float ends[] = {x1, x2, x3, x4};
+            for (int i = 0; i < 4; i += 2) {
+                auto from = max(static_cast<SwCoord>(ceilf(ends[i] - 0.5f)) - xMin, static_cast<SwCoord>(0));
+                auto to = min(static_cast<SwCoord>(ceilf(ends[i + 1] - 0.5f)) - xMin, w);
+                if (from < to) _emitSpan(rle, xMin + from, y, to - from, 255);
+            }
+            continue;
+        }
+
+        //The bands of the row
+        float breaks[10] = {static_cast<float>(y)};
+        uint32_t cnt = 1;
+        _roundRectBreaks(outer, y, y + 1, breaks, cnt);
+        if (inner) _roundRectBreaks(*inner, y, y + 1, breaks, cnt);
+        breaks[cnt++] = y + 1;
+
+        //The pixels the extents end in: [min, max] of the outer and inner ends
+        RoundRectZone zones[4];
+        for (auto& zone : zones) zone = {w + 1, -1};
+
+        for (uint32_t i = 0; i < cnt - 1; ++i) {
+            auto y1 = breaks[i];
+            auto y2 = breaks[i + 1];
+            if (y2 <= y1) continue;
+            auto curved = _roundRectCurved(outer, y1, y2) || (inner && _roundRectCurved(*inner, y1, y2));
+            auto samples = 1;
+            if (curved) {
+                //Flat edges move fast: a sample per ROUND_RECT_DRIFT pixel of their ends at least
+                auto drift = max(_roundRectDrift(outer, y1, y2), inner ? _roundRectDrift(*inner, y1, y2) : 0.0f);
+                samples = static_cast<int>(ceilf(max(ROUND_RECT_SAMPLES * (y2 - y1), drift / ROUND_RECT_DRIFT)));
+                samples = min(max(samples, 1), ROUND_RECT_MAX_SAMPLES);
+            }
+            auto weight = (y2 - y1) / samples;
+
+            for (auto k = 0; k < samples; ++k) {
+                auto sy = y1 + (k + 0.5f) * weight;
+                float x1, x2, x3, x4;
+                if (!_roundRectExtent(outer, sy, x1, x4)) continue;
+                if (inner && _roundRectExtent(*inner, sy, x2, x3)) {
+                    _roundRectCover(arena, x1 - xMin, x2 - xMin, weight, w, zones[0], zones[1]);
+                    _roundRectCover(arena, x3 - xMin, x4 - xMin, weight, w, zones[2], zones[3]);
+                } else {
+                    _roundRectCover(arena, x1 - xMin, x4 - xMin, weight, w, zones[0], zones[3]);
+                }
+            }
+        }
+
+        //Walk the zones in x order, between them the coverage is the sum of the whole pixels so far
+        sort(zones, zones + 4, [](const RoundRectZone& a, const RoundRectZone& b) { return a.min < b.min; });
+
+        auto cover = 0.0f;
+        SwCoord x = 0;
+        for (auto& zone : zones) {
+            if (zone.min > zone.max) continue;
+            auto from = max(zone.min, x);
+            _roundRectEmit(rle, xMin + x, y, from - x, cover);
+            for (auto i = from; i <= zone.max; ++i) {
+                cover += arena.deltas[i];
+                if (i < w) _roundRectEmit(rle, xMin + i, y, 1, cover + arena.covers[i]);
+                arena.deltas[i] = arena.covers[i] = 0.0f;
+            }
+            x = max(x, zone.max + 1);
+        }
+    }
+
+    for (auto y = max(yMax, bbox.min.y); y < bbox.max.y; ++y) rows[y - rle->yMin] = rle->size;
+}
+
+
+/************************************************************************/
+/* External Class Implementation                                        */
+/************************************************************************/
+
+SwRleData* rleRender(SwRleData* rle, SwSpanPool* pool, const SwOutline* outline, const SwBBox& bbox, const SwSize& clip, bool antiAlias, bool accumulate)
+{
+    //Reuse the spans memory of the previous update
+    if (!rle) {
+        rle = static_cast<SwRleData*>(calloc(1, sizeof(SwRleData)));
+        if (!rle) return nullptr;
+        rle->pool = pool;
+    }
+    rle->size = 0;
+    rle->yMin = bbox.min.y;
+
+    //Rows are indexed by _sweep()
+    if (!_growRows(rle, bbox.max.y - bbox.min.y)) {
+        rleFree(rle);
+        return nullptr;
+    }
+
+    if (!antiAlias) {
+        if (_renderAliased(outline, bbox, clip, rle)) {
+            rle->rows[rle->rowCnt] = rle->size;
+            return rle;
+        }
+        rleFree(rle);
+        return nullptr;
+    }
+
+    auto cnt = _chunkCnt(outline, bbox);
+
+    if (cnt == 1) {
+        if (_render(outline, bbox, clip, accumulate, bbox.min.y, bbox.max.y, rle)) {
+            rle->rows[rle->rowCnt] = rle->size;
+            return rle;
+        }
+        rleFree(rle);
+        return nullptr;
+    }
+
+    auto job = make_shared<RleJob>();
+    job->outline = outline;
+    job->bbox = bbox;
+    job->clip = clip;
+    job->accumulate = accumulate;
+    job->cnt = cnt;
+    job->chunkSize = (bbox.max.y - bbox.min.y) / cnt;
+    //The chunks index their own rows of the shared table
+    for (uint32_t i = 0; i < cnt; ++i) job->rles[i] = {nullptr, 0, 0, rle->pool, rle->rows, rle->yMin, rle->rowCnt, 0};
+
+    _requestHelpers(job, cnt - 1);
+    _renderChunks(*job);
+
+    //Wait for the chunks taken by the helpers
+    {
+        unique_lock<mutex> lock{job->mtx};
+        while (job->done < job->cnt) job->finished.wait(lock);
+    }
+
+    //Concatenate the chunks in y order
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < cnt; ++i) size += job->rles[i].size;
+
+    if (!job->failed && size > 0) {
+        if (_growSpans(rle, size)) {
+            for (uint32_t i = 0; i < cnt; ++i) {
+                memcpy(rle->spans + rle->size, job->rles[i].spans, job->rles[i].size * sizeof(SwSpan));
+                //Rebase the row index of the chunk
+                auto row = job->chunkSize * i;
+                auto rowEnd = (i == cnt - 1) ? rle->rowCnt : row + job->chunkSize;
+                for (; row < rowEnd; ++row) rle->rows[row] += rle->size;
+                rle->size += job->rles[i].size;
+            }
+            rle->rows[rle->rowCnt] = rle->size;
+        } else {
+            job->failed = true;
+        }
+    }
+    for (uint32_t i = 0; i < cnt; ++i) _freeSpans(&job->rles[i]);
+
+    if (!job->failed) return rle;
+
+    rleFree(rle);
+    return nullptr;
+}
+
+
+SwRleData* rleHairline(SwRleData* rle, SwSpanPool* pool, const SwOutline* outline, const SwBBox& bbox, const SwSize& clip, float width, StrokeCap cap)
+{
+    if (!rle) {
+        rle = static_cast<SwRleData*>(calloc(1, sizeof(SwRleData)));
+        if (!rle) return nullptr;
+        rle->pool = pool;
+    }
+    rle->size = 0;
+    rle->yMin = bbox.min.y;
+
+    auto hw = width * 0.5f;
+    auto& arena = hairlineArena;
+    arena.segments.clear();
+
+    if (!_growRows(rle, bbox.max.y - bbox.min.y) || !_hairOutline(arena, outline, hw, (cap == StrokeCap::Butt) ? 0.0f : hw) || !_renderHairline(arena, bbox, clip, hw, rle)) {
+        rleFree(rle);
+        return nullptr;
+    }
+    rle->rows[rle->rowCnt] = rle->size;
+
+    return rle;
+}
+
+
+SwRleData* rleRoundRect(SwRleData* rle, SwSpanPool* pool, const SwRoundRect& outer, const SwRoundRect* inner, const SwBBox& bbox, const SwSize& clip, bool antiAlias)
+{
+    if (!rle) {
+        rle = static_cast<SwRleData*>(calloc(1, sizeof(SwRleData)));
+        if (!rle) return nullptr;
+        rle->pool = pool;
+    }
+    rle->size = 0;
+    rle->yMin = bbox.min.y;
+
+    if (!_growRows(rle, bbox.max.y - bbox.min.y)) {
+        rleFree(rle);
+        return nullptr;
+    }
+
+    _renderRoundRect(roundRectArena, outer, inner, bbox, clip, antiAlias, rle);
+    rle->rows[rle->rowCnt] = rle->size;
+
+    return rle;
+}
+
+
+uint32_t rleBandShoots()
+{
+    return bandShoots;
+}
+
+
+void rleTerm()
+{
+    unique_lock<mutex> lock{helpersMtx};
+
+    for (auto helper : helpers) {
+        helper->get();
+        delete(helper);
+    }
+    helpers.clear();
+}
+
+
+bool rleSlice(const SwRleData* rle, SwCoord min, SwCoord max, SwRleData& out)
+{
+    if (!rle || rle->size == 0) return false;
+
+    SwSpan* first;
+    SwSpan* last;
+
+    if (rle->rows) {
+        if (min < rle->yMin) min = rle->yMin;
+        if (max > rle->yMin + static_cast<SwCoord>(rle->rowCnt)) max = rle->yMin + rle->rowCnt;
+        if (min >= max) return false;
+        first = rle->spans + rle->rows[min - rle->yMin];
+        last = rle->spans + rle->rows[max - rle->yMin];
+    } else {
+        //spans are generated in y order, so the y-range is contiguous
+        auto begin = rle->spans;
+        auto end = rle->spans + rle->size;
+        if (begin->y >= max || (end - 1)->y < min) return false;
+
+        first = lower_bound(begin, end, min, [](const SwSpan& span, SwCoord y) { return span.y < y; });
+        last = lower_bound(first, end, max, [](const SwSpan& span, SwCoord y) { return span.y < y; });
+    }
+    if (first == last) return false;
+
+    out.spans = first;
+    out.size = last - first;
+    out.alloc = out.size;
+    out.pool = nullptr;
+    out.rows = nullptr;
+    out.rowCnt = 0;
+    out.rowAlloc = 0;
+
+    return true;
+}
+
+
+bool rleClipRect(const SwRleData* rle, const SwBBox& clip, SwRleData& out)
+{
+    out.size = 0;
+
+    SwRleData slice;
+    if (!rleSlice(rle, clip.min.y, clip.max.y, slice)) return false;
+
+    if (out.alloc < slice.size) {
+        out.alloc = slice.size;
+        out.spans = static_cast<SwSpan*>(realloc(out.spans, out.alloc * sizeof(SwSpan)));
+    }
+
+    auto dst = out.spans;
+
+    //Visit only the spans of the rows crossing the clip
+    if (rle->rows) {
+        auto min = (clip.min.y > rle->yMin ? clip.min.y : rle->yMin) - rle->yMin;
+        auto max = (clip.max.y < rle->yMin + static_cast<SwCoord>(rle->rowCnt) ? clip.max.y : rle->yMin + rle->rowCnt) - rle->yMin;
+        for (auto row = min; row < max; ++row) {
+            dst = _clipRow(rle->spans + rle->rows[row], rle->spans + rle->rows[row + 1], clip, dst);
+        }
+        out.size = dst - out.spans;
+        return (out.size > 0);
+    }
+
+    auto end = slice.spans + slice.size;
+
+    for (auto span = slice.spans; span < end; ++span) {
+        auto x1 = span->x;
+        auto x2 = span->x + span->len;
+        if (x1 < clip.min.x) x1 = clip.min.x;
+        if (x2 > clip.max.x) x2 = clip.max.x;
+        if (x1 >= x2) continue;
+        dst->x = x1;
+        dst->y = span->y;
+        dst->len = x2 - x1;
+        dst->coverage = span->coverage;
+        ++dst;
+    }
+
+    out.size = dst - out.spans;
+
+    return (out.size > 0);
+}
+
+
+bool rleBBox(const SwRleData* rle, SwBBox& bbox)
+{
+    if (!rle || rle->size == 0) return false;
+
+    auto span = rle->spans;
+    auto end = rle->spans + rle->size;
+
+    bbox.min.x = span->x;
+    bbox.max.x = span->x + span->len;
+    bbox.min.y = span->y;
+    bbox.max.y = (end - 1)->y + 1;
+
+    //The spans of a row are sorted by x, only the first and the last ones matter
+    if (rle->rows) {
+        for (uint32_t row = 0; row < rle->rowCnt; ++row) {
+            auto first = rle->rows[row];
+            auto last = rle->rows[row + 1];
+            if (first == last) continue;
+            if (rle->spans[first].x < bbox.min.x) bbox.min.x = rle->spans[first].x;
+            if (rle->spans[last - 1].x + rle->spans[last - 1].len > bbox.max.x) bbox.max.x = rle->spans[last - 1].x + rle->spans[last - 1].len;
+        }
+        return true;
+    }
+
+    for (++span; span < end; ++span) {
+        if (span->x < bbox.min.x) bbox.min.x = span->x;
+        if (span->x + span->len > bbox.max.x) bbox.max.x = span->x + span->len;
+    }
+
+    return true;
+}
+
+
+bool rleIntersect(const SwRleData* lhs, const SwRleData* rhs, SwRleData* out)
+{
+    if (!out || out == lhs || out == rhs) return false;
+    return _merge<RleIntersect>(lhs, rhs, out);
+}
+
+
+bool rleUnion(const SwRleData* lhs, const SwRleData* rhs, SwRleData* out)
+{
+    if (!out || out == lhs || out == rhs) return false;
+    return _merge<RleUnion>(lhs, rhs, out);
+}
+
+
+bool rleSubtract(const SwRleData* lhs, const SwRleData* rhs, SwRleData* out)
+{
+    if (!out || out == lhs || out == rhs) return false;
+    return _merge<RleSubtract>(lhs, rhs, out);
+}
+
+
+bool rleClipPath(SwRleData* rle, const SwRleData* clip)
+{
+    return _mergeInPlace<RleIntersect>(rle, clip);
+}
+
+
+bool rleAddPath(SwRleData* rle, const SwRleData* path)
+{
+    return _mergeInPlace<RleUnion>(rle, path);
+}
+
+
+//Move the spans in place, the ones out of the surface are cut. Returns false if any was cut.
+bool rleTranslate(SwRleData* rle, SwCoord dx, SwCoord dy, const SwSize& clip)
+{
+    if (!rle) return true;
+
+    auto whole = true;
+    auto dst = rle->spans;
+
+    for (auto span = rle->spans, end = rle->spans + rle->size; span < end; ++span) {
+        auto y = span->y + dy;
+        auto x = span->x + dx;
+        auto x2 = x + span->len;
+        if (x < 0) x = 0;
+        if (x2 > clip.w) x2 = clip.w;
+        if (y < 0 || y >= clip.h || x >= x2) {
+            whole = false;
+            continue;
+        }
+        if (x2 - x != span->len) whole = false;
+        dst->x = static_cast<int16_t>(x);
+        dst->y = static_cast<int16_t>(y);
+        dst->len = static_cast<uint16_t>(x2 - x);
+        dst->coverage = span->coverage;
+        ++dst;
+    }
+    rle->size = dst - rle->spans;
+
+    //Index the moved rows again, the cut ones are left empty
+    if (rle->rows) {
+        rle->yMin += dy;
+        uint32_t i = 0;
+        for (uint32_t row = 0; row < rle->rowCnt; ++row) {
+            while (i < rle->size && rle->spans[i].y < rle->yMin + static_cast<SwCoord>(row)) ++i;
+            rle->rows[row] = i;
+        }
+        rle->rows[rle->rowCnt] = rle->size;
+    }
+
+    return whole;
+}
+
+
+void rleReset(SwRleData* rle)
+{
+    if (!rle) return;
+    rle->size = 0;
+}
+
+
+void rleFree(SwRleData* rle)
+{
+    if (!rle) return;
+    _freeSpans(rle);
+    if (rle->rows) free(rle->rows);
+    free(rle);
+}
+
+
+SwSpanPool* rlePoolInit()
+{
+    return new SwSpanPool;
+}
+
+
+void rlePoolTrim(SwSpanPool* pool)
+{
+    if (!pool) return;
+
+    unique_lock<mutex> lock{pool->mtx};
+
+    for (auto& bucket : pool->buckets) {
+        for (auto spans : bucket) free(spans);
+        bucket.clear();
+    }
+    pool->idle = 0;
+    pool->highWater = pool->used;
+}
+
+
+void rlePoolStats(SwSpanPool* pool, uint32_t* used, uint32_t* idle, uint32_t* highWater)
+{
+    if (!pool) return;
+
+    unique_lock<mutex> lock{pool->mtx};
+
+    if (used) *used = pool->used;
+    if (idle) *idle = pool->idle;
+    if (highWater) *highWater = pool->highWater;
+}
+
+
+void rlePoolTerm(SwSpanPool* pool)
+{
+    if (!pool) return;
+
+    rlePoolTrim(pool);
+    delete(pool);
 }
\ No newline at end of file
@@ -25,11 +25,12 @@
 /* Internal Class Implementation                                        */
 /************************************************************************/
 
-struct Line
-{
-    Point pt1;
-    Point pt2;
-};
+//Number of the intervals in the arc length table of a dashed curve
+static constexpr auto SW_DASH_MEASURE_CNT = 16;
+
+//Handle lengths of the corner cubics of Shape::appendCircle() and Shape::appendRect(), in the radii
+static constexpr auto SW_CIRCLE_KAPPA = 0.552284f;
+static constexpr auto SW_RECT_KAPPA = 0.5f;
 
 
 static SwPoint _transform(const Point* to, const Matrix* transform)
@@ -43,31 +44,146 @@ static SwPoint _transform(const Point* to, const Matrix* transform)
 }
 
 
-static float _lineLength(const Point& pt1, const Point& pt2)
+//Kinds of the path transform, the index of the outline point kernels
+enum SwTransformKind {SW_TRANSFORM_IDENTITY = 0, SW_TRANSFORM_TRANSLATE, SW_TRANSFORM_SCALE, SW_TRANSFORM_AFFINE};
+
+
+static SwTransformKind _transformKind(const Matrix* transform)
+{
+    if (!transform) return SW_TRANSFORM_IDENTITY;
+    if (transform->e12 != 0.0f || transform->e21 != 0.0f) return SW_TRANSFORM_AFFINE;
+    if (transform->e11 != 1.0f || transform->e22 != 1.0f) return SW_TRANSFORM_SCALE;
+    return SW_TRANSFORM_TRANSLATE;
+}
+
+
+//Same results as _transform(): the terms of the zero factors can be left out without changing the sums
+template<SwTransformKind kind>
+static void _transformC(const Point* pts, SwOutlinePoint* dst, uint32_t cnt, const Matrix* m)
+{
+    for (; cnt > 0; --cnt, ++pts, ++dst) {
+        if (kind == SW_TRANSFORM_IDENTITY) {
+            *dst = SwPoint{TO_SWCOORD(pts->x), TO_SWCOORD(pts->y)};
+        } else if (kind == SW_TRANSFORM_TRANSLATE) {
+            *dst = SwPoint{TO_SWCOORD(round(pts->x + m->e13)), TO_SWCOORD(round(pts->y + m->e23))};
+        } else if (kind == SW_TRANSFORM_SCALE) {
+            *dst = SwPoint{TO_SWCOORD(round(pts->x * m->e11 + m->e13)), TO_SWCOORD(round(pts->y * m->e22 + m->e23))};
+        } else {
+            *dst = _transform(pts, m);
+        }
+    }
+}
+
+
+#ifdef SW_CPU_DISPATCH
+
+//round(): the halfway cases go away from zero, no rounding mode does that
+SW_TARGET_SSE41 static inline __m128 _roundSse41(__m128 v)
+{
+    auto one = _mm_set1_ps(1.0f);
+    auto t = _mm_round_ps(v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    auto d = _mm_sub_ps(v, t);
+    t = _mm_add_ps(t, _mm_and_ps(_mm_cmpge_ps(d, _mm_set1_ps(0.5f)), one));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmple_ps(d, _mm_set1_ps(-0.5f)), one));
+}
+
+
+//TO_SWCOORD() with the range of SwOutlinePoint
+SW_TARGET_SSE41 static inline __m128i _coordSse41(__m128 v)
+{
+    auto limit = _mm_set1_ps(SW_OUTLINE_COORD_MAX);
+    v = _mm_mul_ps(v, _mm_set1_ps(64.0f));
+    return _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(v, _mm_sub_ps(_mm_setzero_ps(), limit)), limit));
+}
+
+
+//Two interleaved points per vector. The swapped pair of the affine kernel gives the shear terms
+template<SwTransformKind kind>
+SW_TARGET_SSE41 static void _transformSse41(const Point* pts, SwOutlinePoint* dst, uint32_t cnt, const Matrix* m)
+{
+    auto scale = _mm_setzero_ps();
+    auto shear = _mm_setzero_ps();
+    auto offset = _mm_setzero_ps();
+
+    if (kind != SW_TRANSFORM_IDENTITY) {
+        scale = _mm_setr_ps(m->e11, m->e22, m->e11, m->e22);
+        shear = _mm_setr_ps(m->e12, m->e21, m->e12, m->e21);
+        offset = _mm_setr_ps(m->e13, m->e23, m->e13, m->e23);
+    }
+
+    uint32_t i = 0;
+
+    for (; i + 1 < cnt; i += 2) {
+        auto v = _mm_loadu_ps(&pts[i].x);
+        if (kind == SW_TRANSFORM_AFFINE) {
+            auto swapped = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+            v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(v, scale), _mm_mul_ps(swapped, shear)), offset);
+        } else if (kind == SW_TRANSFORM_SCALE) {
+            v = _mm_add_ps(_mm_mul_ps(v, scale), offset);
+        } else if (kind == SW_TRANSFORM_TRANSLATE) {
+            v = _mm_add_ps(v, offset);
+        }
+        if (kind != SW_TRANSFORM_IDENTITY) v = _roundSse41(v);
+        _mm_storeu_si128((__m128i*)(dst + i), _coordSse41(v));
+    }
+    //Pack Leftovers
+    _transformC<kind>(pts + i, dst + i, cnt - i, m);
+}
+
+
+SW_TARGET_AVX2 static inline __m256 _roundAvx2(__m256 v)
 {
-    /* approximate sqrt(x*x + y*y) using alpha max plus beta min algorithm.
-       With alpha = 1, beta = 3/8, giving results with the largest error less
-       than 7% compared to the exact value. */
-    Point diff = {pt2.x - pt1.x, pt2.y - pt1.y};
-    if (diff.x < 0) diff.x = -diff.x;
-    if (diff.y < 0) diff.y = -diff.y;
-    return (diff.x > diff.y) ? (diff.x + diff.y * 0.375f) : (diff.y + diff.x * 0.375f);
+    auto one = _mm256_set1_ps(1.0f);
+    auto t = _mm256_round_ps(v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    auto d = _mm256_sub_ps(v, t);
+    t = _mm256_add_ps(t, _mm256_and_ps(_mm256_cmp_ps(d, _mm256_set1_ps(0.5f), _CMP_GE_OQ), one));
+    return _mm256_sub_ps(t, _mm256_and_ps(_mm256_cmp_ps(d, _mm256_set1_ps(-0.5f), _CMP_LE_OQ), one));
 }
 
 
-static void _lineSplitAt(const Line& cur, float at, Line& left, Line& right)
+SW_TARGET_AVX2 static inline __m256i _coordAvx2(__m256 v)
 {
-    auto len = _lineLength(cur.pt1, cur.pt2);
-    auto dx = ((cur.pt2.x - cur.pt1.x) / len) * at;
-    auto dy = ((cur.pt2.y - cur.pt1.y) / len) * at;
-    left.pt1 = cur.pt1;
-    left.pt2.x = left.pt1.x + dx;
-    left.pt2.y = left.pt1.y + dy;
-    right.pt1 = left.pt2;
-    right.pt2 = cur.pt2;
+    auto limit = _mm256_set1_ps(SW_OUTLINE_COORD_MAX);
+    v = _mm256_mul_ps(v, _mm256_set1_ps(64.0f));
+    return _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(v, _mm256_sub_ps(_mm256_setzero_ps(), limit)), limit));
 }
 
 
+template<SwTransformKind kind>
+SW_TARGET_AVX2 static void _transformAvx2(const Point* pts, SwOutlinePoint* dst, uint32_t cnt, const Matrix* m)
+{
+    auto scale = _mm256_setzero_ps();
+    auto shear = _mm256_setzero_ps();
+    auto offset = _mm256_setzero_ps();
+
+    if (kind != SW_TRANSFORM_IDENTITY) {
+        scale = _mm256_setr_ps(m->e11, m->e22, m->e11, m->e22, m->e11, m->e22, m->e11, m->e22);
+        shear = _mm256_setr_ps(m->e12, m->e21, m->e12, m->e21, m->e12, m->e21, m->e12, m->e21);
+        offset = _mm256_setr_ps(m->e13, m->e23, m->e13, m->e23, m->e13, m->e23, m->e13, m->e23);
+    }
+
+    uint32_t i = 0;
+
+    for (; i + 3 < cnt; i += 4) {
+        auto v = _mm256_loadu_ps(&pts[i].x);
+        if (kind == SW_TRANSFORM_AFFINE) {
+            auto swapped = _mm256_permute_ps(v, _MM_SHUFFLE(2, 3, 0, 1));
+            v = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(v, scale), _mm256_mul_ps(swapped, shear)), offset);
+        } else if (kind == SW_TRANSFORM_SCALE) {
+            v = _mm256_add_ps(_mm256_mul_ps(v, scale), offset);
+        } else if (kind == SW_TRANSFORM_TRANSLATE) {
+            v = _mm256_add_ps(v, offset);
+        }
+        if (kind != SW_TRANSFORM_IDENTITY) v = _roundAvx2(v);
+        _mm256_storeu_si256((__m256i*)(dst + i), _coordAvx2(v));
+    }
+    //Pack Leftovers
+    _transformC<kind>(pts + i, dst + i, cnt - i, m);
+}
+
+#endif
+
+
 static void _growOutlineContour(SwOutline& outline, uint32_t n)
 {
     if (outline.reservedCntrsCnt >= outline.cntrsCnt + n) return;
@@ -80,7 +196,7 @@ static void _growOutlinePoint(SwOutline& outline, uint32_t n)
 {
     if (outline.reservedPtsCnt >= outline.ptsCnt + n) return;
     outline.reservedPtsCnt = outline.ptsCnt + n;
-    outline.pts = static_cast<SwPoint*>(realloc(outline.pts, outline.reservedPtsCnt * sizeof(SwPoint)));
+    outline.pts = static_cast<SwOutlinePoint*>(realloc(outline.pts, outline.reservedPtsCnt * sizeof(SwOutlinePoint)));
     outline.types = static_cast<uint8_t*>(realloc(outline.types, outline.reservedPtsCnt * sizeof(uint8_t)));
 }
 
@@ -106,11 +222,10 @@ static void _outlineEnd(SwOutline& outline)
 }
 
 
-static void _outlineMoveTo(SwOutline& outline, const Point* to, const Matrix* transform)
+//The points are reserved by shapeGenOutline(), they are copied in order from the transformed points
+static void _outlineMoveTo(SwOutline& outline, const SwOutlinePoint* to)
 {
-    _growOutlinePoint(outline, 1);
-
-    outline.pts[outline.ptsCnt] = _transform(to, transform);
+    outline.pts[outline.ptsCnt] = *to;
 
     outline.types[outline.ptsCnt] = SW_CURVE_TYPE_POINT;
 
@@ -124,29 +239,25 @@ static void _outlineMoveTo(SwOutline& outline, const Point* to, const Matrix* tr
 }
 
 
-static void _outlineLineTo(SwOutline& outline, const Point* to, const Matrix* transform)
+static void _outlineLineTo(SwOutline& outline, const SwOutlinePoint* to)
 {
-    _growOutlinePoint(outline, 1);
-
-    outline.pts[outline.ptsCnt] = _transform(to, transform);
+    outline.pts[outline.ptsCnt] = *to;
     outline.types[outline.ptsCnt] = SW_CURVE_TYPE_POINT;
     ++outline.ptsCnt;
 }
 
 
-static void _outlineCubicTo(SwOutline& outline, const Point* ctrl1, const Point* ctrl2, const Point* to, const Matrix* transform)
+static void _outlineCubicTo(SwOutline& outline, const SwOutlinePoint* pts)
 {
-    _growOutlinePoint(outline, 3);
-
-    outline.pts[outline.ptsCnt] = _transform(ctrl1, transform);
+    outline.pts[outline.ptsCnt] = pts[0];
     outline.types[outline.ptsCnt] = SW_CURVE_TYPE_CUBIC;
     ++outline.ptsCnt;
 
-    outline.pts[outline.ptsCnt] = _transform(ctrl2, transform);
+    outline.pts[outline.ptsCnt] = pts[1];
     outline.types[outline.ptsCnt] = SW_CURVE_TYPE_CUBIC;
     ++outline.ptsCnt;
 
-    outline.pts[outline.ptsCnt] = _transform(to, transform);
+    outline.pts[outline.ptsCnt] = pts[2];
     outline.types[outline.ptsCnt] = SW_CURVE_TYPE_POINT;
     ++outline.ptsCnt;
 }
@@ -232,99 +343,198 @@ static bool _checkValid(const SwOutline* outline, const SwBBox& bbox, const SwSi
 }
 
 
-static void _dashLineTo(SwDashStroke& dash, const Point* to, const Matrix* transform)
+static bool _dashed(const Shape* sdata)
 {
-    _growOutlinePoint(*dash.outline, dash.outline->ptsCnt >> 1);
-    _growOutlineContour(*dash.outline, dash.outline->cntrsCnt >> 1);
+    const float* pattern;
+    auto cnt = sdata->strokeDash(&pattern);
+
+    //a pattern which can't be walked is stroked as a solid line
+    auto sum = 0.0f;
+    for (uint32_t i = 0; i < cnt; ++i) {
+        if (pattern[i] < 0.0f) return false;
+        sum += pattern[i];
+    }
+    return sum > 0.0f;
+}
 
-    Line cur = {dash.ptCur, *to};
-    auto len = _lineLength(cur.pt1, cur.pt2);
 
-    if (len < dash.curLen) {
-        dash.curLen -= len;
-        if (!dash.curOpGap) {
-            _outlineMoveTo(*dash.outline, &dash.ptCur, transform);
-            _outlineLineTo(*dash.outline, to, transform);
-        }
-    } else {
-        while (len > dash.curLen) {
-            len -= dash.curLen;
-            Line left, right;
-            _lineSplitAt(cur, dash.curLen, left, right);;
-            dash.curIdx = (dash.curIdx + 1) % dash.cnt;
-            if (!dash.curOpGap) {
-                _outlineMoveTo(*dash.outline, &left.pt1, transform);
-                _outlineLineTo(*dash.outline, &left.pt2, transform);
-            }
-            dash.curLen = dash.pattern[dash.curIdx];
-            dash.curOpGap = !dash.curOpGap;
-            cur = right;
-            dash.ptCur = cur.pt1;
-        }
-        //leftovers
-        dash.curLen -= len;
+static void _dashNext(SwDashStroke& dash)
+{
+    //the current dash is over, let the stroker cap it
+    if (dash.drawing) {
+        strokeEndPath(dash.stroke);
+        dash.drawing = false;
+    }
+    dash.curIdx = (dash.curIdx + 1) % dash.cnt;
+    dash.curLen = dash.pattern[dash.curIdx];
+    dash.curOpGap = !dash.curOpGap;
+}
+
+
+static void _dashBegin(SwDashStroke& dash)
+{
+    //a zero-length dash is drawn by _dashDot() once the direction of the path is known
+    if (dash.drawing || dash.curLen <= 0.0f) return;
+    strokeBeginPath(dash.stroke, _transform(&dash.ptCur, dash.transform), true);
+    dash.drawing = true;
+}
+
+
+//Zero-length dash: only its caps are drawn, facing the direction of the path
+static void _dashDot(SwDashStroke& dash, Point dir)
+{
+    //butt caps have no extent
+    if (dash.stroke->cap == StrokeCap::Butt) return;
+
+    if (dash.transform) {
+        auto m = dash.transform;
+        dir = {dir.x * m->e11 + dir.y * m->e12, dir.x * m->e21 + dir.y * m->e22};
+    }
+
+    SwFixed angle = 0;
+    auto len = sqrtf(dir.x * dir.x + dir.y * dir.y);
+    if (len > FLT_EPSILON) {
+        //scaled up for the precision of the angle
+        angle = mathAtan({static_cast<SwCoord>(dir.x / len * 65536.0f), static_cast<SwCoord>(dir.y / len * 65536.0f)});
+    }
+    strokeDot(dash.stroke, _transform(&dash.ptCur, dash.transform), angle);
+}
+
+
+static void _dashLineTo(SwDashStroke& dash, const Point* to)
+{
+    auto from = dash.ptCur;
+    auto dx = to->x - from.x;
+    auto dy = to->y - from.y;
+    auto len = sqrtf(dx * dx + dy * dy);
+    auto at = 0.0f;
+
+    while (len - at > dash.curLen) {
+        at += dash.curLen;
+        dash.ptCur = {from.x + dx * (at / len), from.y + dy * (at / len)};
         if (!dash.curOpGap) {
-            _outlineMoveTo(*dash.outline, &cur.pt1, transform);
-            _outlineLineTo(*dash.outline, &cur.pt2, transform);
-        }
-        if (dash.curLen < 1) {
-            //move to next dash
-            dash.curIdx = (dash.curIdx + 1) % dash.cnt;
-            dash.curLen = dash.pattern[dash.curIdx];
-            dash.curOpGap = !dash.curOpGap;
+            if (dash.drawing) strokeLineTo(dash.stroke, _transform(&dash.ptCur, dash.transform));
+            else _dashDot(dash, {dx, dy});
         }
+        _dashNext(dash);
+        if (!dash.curOpGap) _dashBegin(dash);
     }
+
+    //leftovers
+    dash.curLen -= len - at;
+    if (dash.drawing) strokeLineTo(dash.stroke, _transform(to, dash.transform));
     dash.ptCur = *to;
 }
 
 
-static void _dashCubicTo(SwDashStroke& dash, const Point* ctrl1, const Point* ctrl2, const Point* to, const Matrix* transform)
+static Point _bezDerivative(const Bezier& bz, float t)
+{
+    auto mt = 1.0f - t;
+    auto a = 3.0f * mt * mt;
+    auto b = 6.0f * mt * t;
+    auto c = 3.0f * t * t;
+    auto dx = a * (bz.ctrl1.x - bz.start.x) + b * (bz.ctrl2.x - bz.ctrl1.x) + c * (bz.end.x - bz.ctrl2.x);
+    auto dy = a * (bz.ctrl1.y - bz.start.y) + b * (bz.ctrl2.y - bz.ctrl1.y) + c * (bz.end.y - bz.ctrl2.y);
+    return {dx, dy};
+}
+
+
+static float _bezSpeed(const Bezier& bz, float t)
 {
-    _growOutlinePoint(*dash.outline, dash.outline->ptsCnt >> 1);
-    _growOutlineContour(*dash.outline, dash.outline->cntrsCnt >> 1);
+    auto d = _bezDerivative(bz, t);
+    return sqrtf(d.x * d.x + d.y * d.y);
+}
+
+
+//Arc length of the curve between t0 and t1 by the 3 points Gauss-Legendre quadrature
+static float _bezMeasure(const Bezier& bz, float t0, float t1)
+{
+    constexpr float nodes[] = {-0.774596669f, 0.0f, 0.774596669f};
+    constexpr float weights[] = {0.555555556f, 0.888888889f, 0.555555556f};
+
+    auto half = 0.5f * (t1 - t0);
+    auto mid = 0.5f * (t0 + t1);
+    auto len = 0.0f;
+    for (int i = 0; i < 3; ++i) len += weights[i] * _bezSpeed(bz, mid + half * nodes[i]);
+    return len * half;
+}
 
-    Bezier cur = { dash.ptCur, *ctrl1, *ctrl2, *to};
-    auto len = bezLength(cur);
 
-    if (len < dash.curLen) {
-        dash.curLen -= len;
+//Parameter of the curve at the arc length, looked up in the cumulative length table
+static float _bezParameter(const Bezier& bz, const float* lens, float at)
+{
+    constexpr auto step = 1.0f / SW_DASH_MEASURE_CNT;
+
+    uint32_t lo = 0;
+    uint32_t hi = SW_DASH_MEASURE_CNT;
+    while (hi - lo > 1) {
+        auto mid = (lo + hi) >> 1;
+        if (lens[mid] <= at) lo = mid;
+        else hi = mid;
+    }
+
+    auto t0 = lo * step;
+    auto segLen = lens[hi] - lens[lo];
+    if (segLen < FLT_EPSILON) return t0;
+
+    //interpolate in the interval, then refine it with a single newton step
+    auto t = t0 + step * (at - lens[lo]) / segLen;
+    auto speed = _bezSpeed(bz, t);
+    if (speed > FLT_EPSILON) t -= (lens[lo] + _bezMeasure(bz, t0, t) - at) / speed;
+
+    if (t < t0) return t0;
+    if (t > t0 + step) return t0 + step;
+    return t;
+}
+
+
+static void _dashCubicTo(SwDashStroke& dash, const Point* ctrl1, const Point* ctrl2, const Point* to)
+{
+    Bezier bz = {dash.ptCur, *ctrl1, *ctrl2, *to};
+
+    //cumulative arc lengths at the evenly spaced parameters
+    float lens[SW_DASH_MEASURE_CNT + 1];
+    lens[0] = 0.0f;
+    for (uint32_t i = 0; i < SW_DASH_MEASURE_CNT; ++i) {
+        lens[i + 1] = lens[i] + _bezMeasure(bz, float(i) / SW_DASH_MEASURE_CNT, float(i + 1) / SW_DASH_MEASURE_CNT);
+    }
+    auto len = lens[SW_DASH_MEASURE_CNT];
+
+    //the remaining curve, which starts at the parameter tCur of the original one
+    auto cur = bz;
+    auto tCur = 0.0f;
+    auto at = 0.0f;
+
+    while (len - at > dash.curLen) {
+        at += dash.curLen;
+        auto t = _bezParameter(bz, lens, at);
+        Bezier left;
+        bezSplitLeft(cur, (tCur < 1.0f) ? (t - tCur) / (1.0f - tCur) : 0.0f, left);
+        tCur = t;
+        dash.ptCur = cur.start;
         if (!dash.curOpGap) {
-            _outlineMoveTo(*dash.outline, &dash.ptCur, transform);
-            _outlineCubicTo(*dash.outline, ctrl1, ctrl2, to, transform);
-        }
-    } else {
-        while (len > dash.curLen) {
-            Bezier left, right;
-            len -= dash.curLen;
-            bezSplitAt(cur, dash.curLen, left, right);
-            dash.curIdx = (dash.curIdx + 1) % dash.cnt;
-            if (!dash.curOpGap) {
-                _outlineMoveTo(*dash.outline, &left.start, transform);
-                _outlineCubicTo(*dash.outline, &left.ctrl1, &left.ctrl2, &left.end, transform);
+            if (dash.drawing) {
+                strokeCubicTo(dash.stroke, _transform(&left.ctrl1, dash.transform), _transform(&left.ctrl2, dash.transform), _transform(&left.end, dash.transform));
+            } else {
+                _dashDot(dash, _bezDerivative(bz, t));
             }
-            dash.curLen = dash.pattern[dash.curIdx];
-            dash.curOpGap = !dash.curOpGap;
-            cur = right;
-            dash.ptCur = right.start;
-        }
-        //leftovers
-        dash.curLen -= len;
-        if (!dash.curOpGap) {
-            _outlineMoveTo(*dash.outline, &cur.start, transform);
-            _outlineCubicTo(*dash.outline, &cur.ctrl1, &cur.ctrl2, &cur.end, transform);
-        }
-        if (dash.curLen < 1) {
-            //move to next dash
-            dash.curIdx = (dash.curIdx + 1) % dash.cnt;
-            dash.curLen = dash.pattern[dash.curIdx];
-            dash.curOpGap = !dash.curOpGap;
         }
+        _dashNext(dash);
+        if (!dash.curOpGap) _dashBegin(dash);
+    }
+
+    //leftovers
+    dash.curLen -= len - at;
+    if (dash.drawing) {
+        strokeCubicTo(dash.stroke, _transform(&cur.ctrl1, dash.transform), _transform(&cur.ctrl2, dash.transform), _transform(to, dash.transform));
     }
     dash.ptCur = *to;
 }
 
 
-SwOutline* _genDashOutline(const Shape* sdata, const Matrix* transform)
+/* Walk the path along the dash pattern and feed the dashes straight to the stroker,
+   without building an intermediate outline of the dash pieces. */
+static bool _dashStroke(SwStroke* stroke, const Shape* sdata, const Matrix* transform)
 {
     const PathCommand* cmds = nullptr;
     auto cmdCnt = sdata->pathCommands(&cmds);
@@ -333,79 +543,46 @@ SwOutline* _genDashOutline(const Shape* sdata, const Matrix* transform)
     auto ptsCnt = sdata->pathCoords(&pts);
 
     //No actual shape data
-    if (cmdCnt == 0 || ptsCnt == 0) return nullptr;
+    if (cmdCnt == 0 || ptsCnt == 0) return false;
 
     SwDashStroke dash;
+    dash.cnt = sdata->strokeDash(&dash.pattern);
+    if (dash.cnt == 0) return false;
+
+    dash.stroke = stroke;
+    dash.transform = transform;
     dash.curIdx = 0;
-    dash.curLen = 0;
+    dash.curLen = dash.pattern[0];
     dash.ptStart = {0, 0};
     dash.ptCur = {0, 0};
     dash.curOpGap = false;
-
-    const float* pattern;
-    dash.cnt = sdata->strokeDash(&pattern);
-    if (dash.cnt == 0) return nullptr;
-
-    //Is it safe to mutual exclusive?
-    dash.pattern = const_cast<float*>(pattern);
-    dash.outline = static_cast<SwOutline*>(calloc(1, sizeof(SwOutline)));
-    dash.outline->opened = true;
-
-    //smart reservation
-    auto outlinePtsCnt = 0;
-    auto outlineCntrsCnt = 0;
-
-    for (uint32_t i = 0; i < cmdCnt; ++i) {
-        switch(*(cmds + i)) {
-            case PathCommand::Close: {
-                ++outlinePtsCnt;
-                break;
-            }
-            case PathCommand::MoveTo: {
-                ++outlineCntrsCnt;
-                ++outlinePtsCnt;
-                break;
-            }
-            case PathCommand::LineTo: {
-                ++outlinePtsCnt;
-                break;
-            }
-            case PathCommand::CubicTo: {
-                outlinePtsCnt += 3;
-                break;
-            }
-        }
-    }
-
-    ++outlinePtsCnt;    //for close
-    ++outlineCntrsCnt;  //for end
-
-    //Reserve Approximitely 20x...
-    _growOutlinePoint(*dash.outline, outlinePtsCnt * 20);
-    _growOutlineContour(*dash.outline, outlineCntrsCnt * 20);
+    dash.drawing = false;
 
     while (cmdCnt-- > 0) {
         switch(*cmds) {
             case PathCommand::Close: {
-                _dashLineTo(dash, &dash.ptStart, transform);
+                _dashLineTo(dash, &dash.ptStart);
                 break;
             }
             case PathCommand::MoveTo: {
                 //reset the dash
+                if (dash.drawing) strokeEndPath(stroke);
+                dash.drawing = false;
                 dash.curIdx = 0;
-                dash.curLen = *dash.pattern;
+                dash.curLen = dash.pattern[0];
                 dash.curOpGap = false;
                 dash.ptStart = dash.ptCur = *pts;
+                _dashBegin(dash);
                 ++pts;
                 break;
             }
             case PathCommand::LineTo: {
-                _dashLineTo(dash, pts, transform);
+                _dashLineTo(dash, pts);
                 ++pts;
                 break;
             }
             case PathCommand::CubicTo: {
-                _dashCubicTo(dash, pts, pts + 1, pts + 2, transform);
+                _dashCubicTo(dash, pts, pts + 1, pts + 2);
                 pts += 3;
                 break;
             }
@@ -413,9 +590,48 @@ SwOutline* _genDashOutline(const Shape* sdata, const Matrix* transform)
         ++cmds;
     }
 
-    _outlineEnd(*dash.outline);
+    if (dash.drawing) strokeEndPath(stroke);
+
+    return true;
+}
+
+
+//Device width of a stroke thin enough to be drawn as a hairline, zero otherwise
+static float _hairlineWidth(const SwStroke* stroke)
+{
+    constexpr auto MAX_HAIRLINE_WIDTH = 1.5f;
+
+    if (stroke->width <= 0 || max(stroke->sx, stroke->sy) * stroke->width > MAX_HAIRLINE_WIDTH * 32.0f) return 0.0f;
+
+    //the half width in 26.6, on the average scale
+    return (stroke->sx + stroke->sy) * stroke->width / 64.0f;
+}
+
 
-    return dash.outline;
+/* The cell lists cost grows with the square of the edge crossings per row, while
+   a dense accumulation buffer costs the bbox width. Use it once it's cheaper. */
+static bool _accumulate(const SwOutline* outline, const SwBBox& bbox)
+{
+    constexpr auto MAX_ACCUM_WIDTH = 4096;
+
+    auto w = bbox.max.x - bbox.min.x;
+    auto h = bbox.max.y - bbox.min.y;
+    if (w > MAX_ACCUM_WIDTH || h <= 0) return false;
+
+    //Vertical length of the edges, in 26.6 units, that makes (crossings per row)^2 reach 2 * width
+    auto limit = static_cast<int64_t>(sqrt(2.0f * w) * h * 64.0f);
+    int64_t sum = 0;
+    uint32_t first = 0;
+
+    for (uint32_t i = 0; i < outline->cntrsCnt; ++i) {
+        auto last = outline->cntrs[i];
+        auto pt = outline->pts + first;
+        for (auto end = outline->pts + last; pt < end; ++pt) sum += abs(pt[1].y - pt[0].y);
+        sum += abs(outline->pts[first].y - pt->y);
+        if (sum >= limit) return true;
+        first = last + 1;
+    }
+    return false;
 }
 
 
@@ -441,6 +657,157 @@ bool _fastTrack(const SwOutline* outline)
 }
 
 
+static bool _near(const Point& pt1, const Point& pt2, float tolerance)
+{
+    return fabsf(pt1.x - pt2.x) <= tolerance && fabsf(pt1.y - pt2.y) <= tolerance;
+}
+
+
+//A curve from pts[0] to pts[3] around the corner of their box, with the handles of the ratio k
+static bool _roundCorner(const Point* pts, float k, float tolerance)
+{
+    auto& from = pts[0];
+    auto& to = pts[3];
+    Point corners[] = {{to.x, from.y}, {from.x, to.y}};
+
+    for (auto& corner : corners) {
+        Point ctrl1 = {from.x + k * (corner.x - from.x), from.y + k * (corner.y - from.y)};
+        Point ctrl2 = {to.x + k * (corner.x - to.x), to.y + k * (corner.y - to.y)};
+        if (_near(pts[1], ctrl1, tolerance) && _near(pts[2], ctrl2, tolerance)) return true;
+    }
+    return false;
+}
+
+
+static bool _commands(const PathCommand* cmds, uint32_t cmdCnt, const PathCommand* expected, uint32_t cnt)
+{
+    if (cmdCnt != cnt) return false;
+    return memcmp(cmds, expected, cnt * sizeof(PathCommand)) == 0;
+}
+
+
+/* Recognize the rectangle, the rounded rectangle and the ellipse of Shape::appendRect()
+   and Shape::appendCircle() under a transform without rotation. Their corners are covered
+   against the very cubics of the outline: the 0.5 handles of appendRect() and the kappa
+   ones of appendCircle(). */
+static bool _roundRect(const Shape* sdata, const Matrix* transform, SwRoundRect& rr)
+{
+    constexpr PathCommand RECT[] = {PathCommand::MoveTo, PathCommand::LineTo, PathCommand::LineTo, PathCommand::LineTo, PathCommand::Close};
+    constexpr PathCommand ROUND_RECT[] = {PathCommand::MoveTo, PathCommand::LineTo, PathCommand::CubicTo, PathCommand::LineTo, PathCommand::CubicTo,
+                                          PathCommand::LineTo, PathCommand::CubicTo, PathCommand::LineTo, PathCommand::CubicTo, PathCommand::Close};
+    constexpr PathCommand CIRCLE[] = {PathCommand::MoveTo, PathCommand::CubicTo, PathCommand::CubicTo, PathCommand::CubicTo, PathCommand::CubicTo, PathCommand::Close};
+
+    if (transform && (fabsf(transform->e12) > FLT_EPSILON || fabsf(transform->e21) > FLT_EPSILON)) return false;
+
+    const PathCommand* cmds = nullptr;
+    auto cmdCnt = sdata->pathCommands(&cmds);
+
+    const Point* pts = nullptr;
+    auto ptsCnt = sdata->pathCoords(&pts);
+
+    float x1, y1, x2, y2;
+    auto rx = 0.0f;
+    auto ry = 0.0f;
+    auto k = 0.0f;
+
+    if (ptsCnt == 4 && _commands(cmds, cmdCnt, RECT, 5)) {
+        if (pts[0].y != pts[1].y || pts[1].x != pts[2].x || pts[2].y != pts[3].y || pts[3].x != pts[0].x) return false;
+        x1 = pts[0].x;
+        y1 = pts[0].y;
+        x2 = pts[2].x;
+        y2 = pts[2].y;
+    } else if (ptsCnt == 17 && _commands(cmds, cmdCnt, ROUND_RECT, 10)) {
+        //From the top left end, clockwise
+        x1 = pts[13].x;
+        y1 = pts[0].y;
+        x2 = pts[4].x;
+        y2 = pts[8].y;
+        rx = pts[0].x - x1;
+        ry = pts[13].y - y1;
+        if (rx <= 0.0f || ry <= 0.0f) return false;
+        auto tolerance = (x2 - x1 + y2 - y1) * 1e-4f;
+        if (!_near(pts[1], {x2 - rx, y1}, tolerance) || !_near(pts[5], {x2, y2 - ry}, tolerance) ||
+            !_near(pts[9], {x1 + rx, y2}, tolerance) || !_near(pts[16], pts[0], tolerance)) return false;
+        for (int i = 1; i < 17; i += 4) {
+            if (!_roundCorner(pts + i, SW_RECT_KAPPA, tolerance)) return false;
+        }
+        k = SW_RECT_KAPPA;
+    } else if (ptsCnt == 13 && _commands(cmds, cmdCnt, CIRCLE, 6)) {
+        //From the top, clockwise
+        auto cx = pts[0].x;
+        auto cy = pts[3].y;
+        rx = pts[3].x - cx;
+        ry = cy - pts[0].y;
+        if (rx <= 0.0f || ry <= 0.0f) return false;
+        auto tolerance = (rx + ry) * 1e-4f;
+        if (!_near(pts[6], {cx, cy + ry}, tolerance) || !_near(pts[9], {cx - rx, cy}, tolerance) || !_near(pts[12], pts[0], tolerance)) return false;
+        for (int i = 0; i < 12; i += 3) {
+            if (!_roundCorner(pts + i, SW_CIRCLE_KAPPA, tolerance)) return false;
+        }
+        x1 = cx - rx;
+        y1 = cy - ry;
+        x2 = cx + rx;
+        y2 = cy + ry;
+        k = SW_CIRCLE_KAPPA;
+    } else {
+        return false;
+    }
+
+    //The device points of the outline, in its precision
+    Point from = {x1, y1};
+    Point to = {x2, y2};
+    Point radii = {x1 + rx, y1 + ry};
+    auto pt1 = _transform(&from, transform);
+    auto pt2 = _transform(&to, transform);
+    auto pt3 = _transform(&radii, transform);
+
+    rr.x1 = min(pt1.x, pt2.x) / 64.0f;
+    rr.x2 = max(pt1.x, pt2.x) / 64.0f;
+    rr.y1 = min(pt1.y, pt2.y) / 64.0f;
+    rr.y2 = max(pt1.y, pt2.y) / 64.0f;
+    if (rr.x1 >= rr.x2 || rr.y1 >= rr.y2) return false;
+
+    rr.rx = abs(pt3.x - pt1.x) / 64.0f;
+    rr.ry = abs(pt3.y - pt1.y) / 64.0f;
+    rr.k = k;
+    rr.bevel = false;
+
+    return true;
+}
+
+
+//The outer and the inner edges of the stroke of a round fast track shape
+static bool _strokeRoundRect(const SwStroke* stroke, const SwRoundRect& rr, SwRoundRect& outer, SwRoundRect& inner, bool& hole)
+{
+    auto hwx = stroke->width * stroke->sx / 64.0f;
+    auto hwy = stroke->width * stroke->sy / 64.0f;
+
+    outer = {rr.x1 - hwx, rr.y1 - hwy, rr.x2 + hwx, rr.y2 + hwy, 0.0f, 0.0f, SW_CIRCLE_KAPPA, false};
+    inner = {rr.x1 + hwx, rr.y1 + hwy, rr.x2 - hwx, rr.y2 - hwy, 0.0f, 0.0f, SW_CIRCLE_KAPPA, false};
+
+    if (rr.rx > 0.0f && rr.ry > 0.0f) {
+        /* Only the offsets of the circular arcs are the arcs of the offset radii,
+           the ones of the 0.5 handle corners are left to the stroker */
+        if (rr.k != SW_CIRCLE_KAPPA || fabsf(rr.rx - rr.ry) > rr.rx * 0.01f || fabsf(hwx - hwy) > hwx * 0.01f) return false;
+        outer.rx = rr.rx + hwx;
+        outer.ry = rr.ry + hwy;
+        if (rr.rx > hwx && rr.ry > hwy) {
+            inner.rx = rr.rx - hwx;
+            inner.ry = rr.ry - hwy;
+        }
+    //The joins of the corners, the round ones are the kappa arcs of the stroker
+    } else if (stroke->join != StrokeJoin::Miter) {
+        outer.rx = hwx;
+        outer.ry = hwy;
+        outer.bevel = (stroke->join == StrokeJoin::Bevel);
+    }
+
+    hole = (inner.x1 < inner.x2 && inner.y1 < inner.y2);
+
+    return true;
+}
+
+
 /************************************************************************/
 /* External Class Implementation                                        */
 /************************************************************************/
@@ -453,25 +820,92 @@ bool shapePrepare(SwShape* shape, const Shape* sdata, const SwSize& clip, const
 
     if (!_checkValid(shape->outline, shape->bbox, clip)) return false;
 
+    shape->round = _roundRect(sdata, transform, shape->roundRect);
+
     return true;
 }
 
 
-bool shapeGenRle(SwShape* shape, TVG_UNUSED const Shape* sdata, const SwSize& clip, bool antiAlias)
+bool shapeGenRle(SwShape* shape, TVG_UNUSED const Shape* sdata, const SwSize& clip, bool antiAlias, bool hasComposite)
 {
     //FIXME: Should we draw it?
     //Case: Stroke Line
     //if (shape.outline->opened) return true;
 
-    //Case A: Fast Track Rectangle Drawing
-    if ((shape->rect = _fastTrack(shape->outline))) return true;
-    //Case B: Normale Shape RLE Drawing
-    if ((shape->rle = rleRender(shape->outline, shape->bbox, clip, antiAlias))) return true;
+    //Case A: Fast Track Rectangle Drawing, composition needs the rle.
+    if (!hasComposite && (shape->rect = _fastTrack(shape->outline))) return true;
+    //Case B: Analytic Rectangle, Rounded Rectangle and Ellipse Drawing
+    if (shape->round) {
+        shape->rle = rleRoundRect(shape->rle, shape->pool, shape->roundRect, nullptr, shape->bbox, clip, antiAlias);
+        return shape->rle ? true : false;
+    }
+    //Case C: Normale Shape RLE Drawing
+    if ((shape->rle = rleRender(shape->rle, shape->pool, shape->outline, shape->bbox, clip, antiAlias, _accumulate(shape->outline, shape->bbox)))) return true;
 
     return false;
 }
 
 
+//Move the cached rles and bbox by whole pixels. Returns false once a part of the shape is out of the surface.
+bool shapeTranslate(SwShape* shape, SwCoord dx, SwCoord dy, const SwSize& clip)
+{
+    auto whole = rleTranslate(shape->rle, dx, dy, clip);
+    if (!rleTranslate(shape->strokeRle, dx, dy, clip)) whole = false;
+
+    auto& bbox = shape->bbox;
+    bbox.min.x += dx;
+    bbox.min.y += dy;
+    bbox.max.x += dx;
+    bbox.max.y += dy;
+
+    if (bbox.min.x < 0 || bbox.min.y < 0 || bbox.max.x > clip.w || bbox.max.y > clip.h) {
+        if (bbox.min.x < 0) bbox.min.x = 0;
+        if (bbox.min.y < 0) bbox.min.y = 0;
+        if (bbox.max.x > clip.w) bbox.max.x = clip.w;
+        if (bbox.max.y > clip.h) bbox.max.y = clip.h;
+        //Nothing left of the fast track rectangle
+        if (bbox.min.x >= bbox.max.x || bbox.min.y >= bbox.max.y) shape->rect = false;
+        whole = false;
+    }
+
+    return whole;
+}
+
+
+void shapeInit(SwCpu cpu)
+{
+    //Indexed by SwTransformKind
+    swKernels.transform[SW_TRANSFORM_IDENTITY] = _transformC<SW_TRANSFORM_IDENTITY>;
+    swKernels.transform[SW_TRANSFORM_TRANSLATE] = _transformC<SW_TRANSFORM_TRANSLATE>;
+    swKernels.transform[SW_TRANSFORM_SCALE] = _transformC<SW_TRANSFORM_SCALE>;
+    swKernels.transform[SW_TRANSFORM_AFFINE] = _transformC<SW_TRANSFORM_AFFINE>;
+
+#ifdef SW_CPU_DISPATCH
+    if (cpu == SW_CPU_AVX2) {
+        swKernels.transform[SW_TRANSFORM_IDENTITY] = _transformAvx2<SW_TRANSFORM_IDENTITY>;
+        swKernels.transform[SW_TRANSFORM_TRANSLATE] = _transformAvx2<SW_TRANSFORM_TRANSLATE>;
+        swKernels.transform[SW_TRANSFORM_SCALE] = _transformAvx2<SW_TRANSFORM_SCALE>;
+        swKernels.transform[SW_TRANSFORM_AFFINE] = _transformAvx2<SW_TRANSFORM_AFFINE>;
+    } else if (cpu == SW_CPU_SSE41) {
+        swKernels.transform[SW_TRANSFORM_IDENTITY] = _transformSse41<SW_TRANSFORM_IDENTITY>;
+        swKernels.transform[SW_TRANSFORM_TRANSLATE] = _transformSse41<SW_TRANSFORM_TRANSLATE>;
+        swKernels.transform[SW_TRANSFORM_SCALE] = _transformSse41<SW_TRANSFORM_SCALE>;
+        swKernels.transform[SW_TRANSFORM_AFFINE] = _transformSse41<SW_TRANSFORM_AFFINE>;
+    }
+#endif
+}
+
+
+void shapeResetOutline(SwShape* shape)
+{
+    //Keep the memory for the next update, the outline is generated again from the path
+    auto outline = shape->outline;
+    if (!outline) return;
+    outline->ptsCnt = 0;
+    outline->cntrsCnt = 0;
+}
+
+
 void shapeDelOutline(SwShape* shape)
 {
     auto outline = shape->outline;
@@ -482,10 +916,10 @@ void shapeDelOutline(SwShape* shape)
 
 void shapeReset(SwShape* shape)
 {
-    shapeDelOutline(shape);
-    rleFree(shape->rle);
-    shape->rle = nullptr;
+    shapeResetOutline(shape);
+    rleReset(shape->rle);
     shape->rect = false;
+    shape->round = false;
     _initBBox(shape->bbox);
 }
 
@@ -502,8 +936,9 @@ bool shapeGenOutline(SwShape* shape, const Shape* sdata, const Matrix* transform
     if (cmdCnt == 0 || ptsCnt == 0) return false;
 
     //smart reservation
-    auto outlinePtsCnt = 0;
-    auto outlineCntrsCnt = 0;
+    uint32_t pathPtsCnt = 0;
+    uint32_t outlinePtsCnt = 0;
+    uint32_t outlineCntrsCnt = 0;
 
     for (uint32_t i = 0; i < cmdCnt; ++i) {
         switch(*(cmds + i)) {
@@ -514,29 +949,42 @@ bool shapeGenOutline(SwShape* shape, const Shape* sdata, const Matrix* transform
             case PathCommand::MoveTo: {
                 ++outlineCntrsCnt;
                 ++outlinePtsCnt;
+                ++pathPtsCnt;
                 break;
             }
             case PathCommand::LineTo: {
                 ++outlinePtsCnt;
+                ++pathPtsCnt;
                 break;
             }
             case PathCommand::CubicTo: {
                 outlinePtsCnt += 3;
+                pathPtsCnt += 3;
                 break;
             }
         }
     }
 
+    //The commands use more points than the path has
+    if (pathPtsCnt > ptsCnt) return false;
+
     ++outlinePtsCnt;    //for close
     ++outlineCntrsCnt;  //for end
 
     auto outline = shape->outline;
     if (!outline) outline = static_cast<SwOutline*>(calloc(1, sizeof(SwOutline)));
+    outline->ptsCnt = 0;
+    outline->cntrsCnt = 0;
     outline->opened = true;
 
     _growOutlinePoint(*outline, outlinePtsCnt);
     _growOutlineContour(*outline, outlineCntrsCnt);
 
+    //Transform all the points at once, to the tail of the outline. The walk moves them to their places,
+    //which never go ahead of the reading: the closing points are the only ones added.
+    auto src = outline->pts + (outlinePtsCnt - pathPtsCnt);
+    swKernels.transform[_transformKind(transform)](pts, src, pathPtsCnt, transform);
+
     auto closed = false;
 
     //Generate Outlines
@@ -548,18 +996,18 @@ bool shapeGenOutline(SwShape* shape, const Shape* sdata, const Matrix* transform
                 break;
             }
             case PathCommand::MoveTo: {
-                _outlineMoveTo(*outline, pts, transform);
-                ++pts;
+                _outlineMoveTo(*outline, src);
+                ++src;
                 break;
             }
             case PathCommand::LineTo: {
-                _outlineLineTo(*outline, pts, transform);
-                ++pts;
+                _outlineLineTo(*outline, src);
+                ++src;
                 break;
             }
             case PathCommand::CubicTo: {
-                _outlineCubicTo(*outline, pts, pts + 1, pts + 2, transform);
-                pts += 3;
+                _outlineCubicTo(*outline, src);
+                src += 3;
                 break;
             }
         }
@@ -610,57 +1058,60 @@ void shapeResetStroke(SwShape* shape, const Shape* sdata, const Matrix* transfor
 
     strokeReset(stroke, sdata, transform);
 
-    rleFree(shape->strokeRle);
-    shape->strokeRle = nullptr;
+    rleReset(shape->strokeRle);
 }
 
 
 bool shapeGenStrokeRle(SwShape* shape, const Shape* sdata, const Matrix* transform, const SwSize& clip)
 {
-    SwOutline* shapeOutline = nullptr;
-    SwOutline* strokeOutline = nullptr;
-    bool freeOutline = false;
-    bool ret = true;
+    //Analytic Rectangle, Rounded Rectangle and Ellipse Stroke
+    SwRoundRect rr, outer, inner;
+    bool hole;
+    if (!_dashed(sdata) && _roundRect(sdata, transform, rr) && _strokeRoundRect(shape->stroke, rr, outer, inner, hole)) {
+        SwBBox bbox = {{static_cast<SwCoord>(floorf(outer.x1)), static_cast<SwCoord>(floorf(outer.y1))},
+                       {static_cast<SwCoord>(ceilf(outer.x2)), static_cast<SwCoord>(ceilf(outer.y2))}};
+        if (bbox.min.x >= clip.w || bbox.min.y >= clip.h || bbox.max.x <= 0 || bbox.max.y <= 0) return false;
+        shape->strokeRle = rleRoundRect(shape->strokeRle, shape->pool, outer, hole ? &inner : nullptr, bbox, clip, sdata->antiAlias());
+        return shape->strokeRle ? true : false;
+    }
 
     //Dash Style Stroke
-    if (sdata->strokeDash(nullptr) > 0) {
-        shapeOutline = _genDashOutline(sdata, transform);
-        if (!shapeOutline) return false;
-        freeOutline = true;
+    if (_dashed(sdata)) {
+        if (!_dashStroke(shape->stroke, sdata, transform)) return false;
     //Normal Style stroke
     } else {
-        if (!shape->outline) {
+        if (!shape->outline || shape->outline->ptsCnt == 0) {
             if (!shapeGenOutline(shape, sdata, transform)) return false;
         }
-        shapeOutline = shape->outline;
-    }
 
-    if (!strokeParseOutline(shape->stroke, *shapeOutline)) {
-        ret = false;
-        goto fail;
-    }
+        //Hairline, rasterized along the path without the stroke outline
+        auto width = _hairlineWidth(shape->stroke);
+        if (width > 0.0f && sdata->antiAlias()) {
+            SwBBox bbox;
+            _updateBBox(shape->outline, bbox);
+            bbox.min.x -= 2;
+            bbox.min.y -= 2;
+            bbox.max.x += 2;
+            bbox.max.y += 2;
+            if (!_checkValid(shape->outline, bbox, clip)) return false;
+            shape->strokeRle = rleHairline(shape->strokeRle, shape->pool, shape->outline, bbox, clip, width, sdata->strokeCap());
+            return shape->strokeRle ? true : false;
+        }
 
-    strokeOutline = strokeExportOutline(shape->stroke);
-    if (!strokeOutline) {
-        ret = false;
-        goto fail;
+        if (!strokeParseOutline(shape->stroke, *shape->outline)) return false;
     }
 
+    auto strokeOutline = strokeExportOutline(shape->stroke);
+    if (!strokeOutline) return false;
+
     SwBBox bbox;
     _updateBBox(strokeOutline, bbox);
 
-    if (!_checkValid(strokeOutline, bbox, clip)) {
-        ret = false;
-        goto fail;
-    }
-
-    shape->strokeRle = rleRender(strokeOutline, bbox, clip, true);
+    if (!_checkValid(strokeOutline, bbox, clip)) return false;
 
-fail:
-    if (freeOutline) _delOutline(shapeOutline);
-    _delOutline(strokeOutline);
+    shape->strokeRle = rleRender(shape->strokeRle, shape->pool, strokeOutline, bbox, clip, sdata->antiAlias(), _accumulate(strokeOutline, bbox));
 
-    return ret;
+    return true;
 }
 
 
@@ -774,13 +774,14 @@ static void _exportBorderOutline(SwStroke& stroke, SwOutline* outline, uint32_t
 
     if (!border->valid) return;
 
-    memcpy(outline->pts + outline->ptsCnt, border->pts, border->ptsCnt * sizeof(SwPoint));
+    auto dst = outline->pts + outline->ptsCnt;
+    for (uint32_t i = 0; i < border->ptsCnt; ++i) dst[i] = border->pts[i];
 
     auto cnt = border->ptsCnt;
     auto src = border->tags;
     auto tags = outline->types + outline->ptsCnt;
     auto cntrs = outline->cntrs + outline->cntrsCnt;
-    uint16_t idx = outline->ptsCnt;
+    uint32_t idx = outline->ptsCnt;
 
     while (cnt > 0) {
 
@@ -818,6 +819,11 @@ void strokeFree(SwStroke* stroke)
     if (stroke->borders[1].pts) free(stroke->borders[1].pts);
     if (stroke->borders[1].tags) free(stroke->borders[1].tags);
 
+    //free the exported outline
+    if (stroke->outline.cntrs) free(stroke->outline.cntrs);
+    if (stroke->outline.pts) free(stroke->outline.pts);
+    if (stroke->outline.types) free(stroke->outline.types);
+
     free(stroke);
 }
 
@@ -861,7 +867,7 @@ bool strokeParseOutline(SwStroke* stroke, const SwOutline& outline)
             continue;
         }
 
-        auto start = outline.pts[first];
+        SwPoint start = outline.pts[first];
         auto pt = outline.pts + first;
         auto types = outline.types + first;
         auto type = types[0];
@@ -902,6 +908,44 @@ bool strokeParseOutline(SwStroke* stroke, const SwOutline& outline)
 }
 
 
+void strokeBeginPath(SwStroke* stroke, const SwPoint& to, bool opened)
+{
+    auto start = to;
+    _beginSubPath(*stroke, start, opened);
+}
+
+
+void strokeLineTo(SwStroke* stroke, const SwPoint& to)
+{
+    _lineTo(*stroke, to);
+}
+
+
+void strokeCubicTo(SwStroke* stroke, const SwPoint& ctrl1, const SwPoint& ctrl2, const SwPoint& to)
+{
+    _cubicTo(*stroke, ctrl1, ctrl2, to);
+}
+
+
+void strokeEndPath(SwStroke* stroke)
+{
+    //Nothing to cap or join if no segment has been stroked yet
+    if (!stroke->firstPt) _endSubPath(*stroke);
+}
+
+
+void strokeDot(SwStroke* stroke, const SwPoint& center, SwFixed angle)
+{
+    //A zero-length open subpath: only its two caps are drawn, facing the angle
+    auto start = center;
+    _beginSubPath(*stroke, start, true);
+    _firstSubPath(*stroke, angle, 0);
+    stroke->angleIn = angle;
+    _endSubPath(*stroke);
+    stroke->firstPt = true;
+}
+
+
 SwOutline* strokeExportOutline(SwStroke* stroke)
 {
     uint32_t count1, count2, count3, count4;
@@ -912,10 +956,20 @@ SwOutline* strokeExportOutline(SwStroke* stroke)
     auto ptsCnt = count1 + count3;
     auto cntrsCnt = count2 + count4;
 
-    auto outline = static_cast<SwOutline*>(calloc(1, sizeof(SwOutline)));
-    outline->pts = static_cast<SwPoint*>(malloc(sizeof(SwPoint) * ptsCnt));
-    outline->types = static_cast<uint8_t*>(malloc(sizeof(uint8_t) * ptsCnt));
-    outline->cntrs = static_cast<uint32_t*>(malloc(sizeof(uint32_t) * cntrsCnt));
+    //Reuse the outline of the previous export, it only grows
+    auto outline = &stroke->outline;
+    outline->ptsCnt = 0;
+    outline->cntrsCnt = 0;
+
+    if (outline->reservedPtsCnt < ptsCnt) {
+        outline->reservedPtsCnt = ptsCnt;
+        outline->pts = static_cast<SwOutlinePoint*>(realloc(outline->pts, sizeof(SwOutlinePoint) * ptsCnt));
+        outline->types = static_cast<uint8_t*>(realloc(outline->types, sizeof(uint8_t) * ptsCnt));
+    }
+    if (outline->reservedCntrsCnt < cntrsCnt) {
+        outline->reservedCntrsCnt = cntrsCnt;
+        outline->cntrs = static_cast<uint32_t*>(realloc(outline->cntrs, sizeof(uint32_t) * cntrsCnt));
+    }
 
     _exportBorderOutline(*stroke, outline, 0);  //left
     _exportBorderOutline(*stroke, outline, 1);  //right
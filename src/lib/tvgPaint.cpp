@@ -71,4 +71,16 @@ Result Paint::bounds(float* x, float* y, float* w, float* h) const noexcept
 {
     if (IMPL->bounds(x, y, w, h)) return Result::Success;
     return Result::InsufficientCondition;
+}
+
+
+Result Paint::composite(unique_ptr<Paint> target, CompositeMethod method) noexcept
+{
+    if (!target || method != CompositeMethod::ClipPath) return Result::InvalidArguments;
+
+    auto p = target.release();
+    if (IMPL->composite(p, method)) return Result::Success;
+
+    delete(p);
+    return Result::InsufficientCondition;
 }
\ No newline at end of file
@@ -39,10 +39,14 @@ namespace tvg
         StrategyMethod* smethod = nullptr;
         RenderTransform *rTransform = nullptr;
         uint32_t flag = RenderUpdateFlag::None;
+        Paint* compTarget = nullptr;
+        CompositeMethod compMethod = CompositeMethod::None;
+        void* compData = nullptr;           //clip path of the renderer
 
         ~Impl() {
             if (smethod) delete(smethod);
             if (rTransform) delete(rTransform);
+            if (compTarget) delete(compTarget);
         }
 
         void method(StrategyMethod* method)
@@ -113,9 +117,43 @@ namespace tvg
             return smethod->bounds(x, y, w, h);
         }
 
+        bool composite(Paint* target, CompositeMethod method)
+        {
+            if (compTarget) return false;
+
+            compTarget = target;
+            compMethod = method;
+            flag |= RenderUpdateFlag::Path;
+
+            return true;
+        }
+
         bool dispose(RenderMethod& renderer)
         {
-            return smethod->dispose(renderer);
+            auto ret = smethod->dispose(renderer);
+
+            //The clipped contents are done, release their clip path
+            if (compTarget) {
+                compTarget->pImpl->dispose(renderer);
+                renderer.disposeClipPath(compData);
+                compData = nullptr;
+            }
+            return ret;
+        }
+
+        bool updateContents(RenderMethod& renderer, const RenderTransform* transform, RenderUpdateFlag flag)
+        {
+            if (!compTarget) return smethod->update(renderer, transform, flag);
+
+            //The clip path is in the local space of this paint
+            if (!renderer.beginClipPath()) return false;
+            compTarget->pImpl->update(renderer, transform, flag);
+            compData = renderer.endClipPath(compData);
+
+            auto ret = smethod->update(renderer, transform, flag);
+            renderer.popClipPath();
+
+            return ret;
         }
 
         bool update(RenderMethod& renderer, const RenderTransform* pTransform, uint32_t pFlag)
@@ -133,10 +171,10 @@ namespace tvg
 
             if (rTransform && pTransform) {
                 RenderTransform outTransform(pTransform, rTransform);
-                return smethod->update(renderer, &outTransform, newFlag);
+                return updateContents(renderer, &outTransform, newFlag);
             } else {
                 auto outTransform = pTransform ? pTransform : rTransform;
-                return smethod->update(renderer, outTransform, newFlag);
+                return updateContents(renderer, outTransform, newFlag);
             }
         }
 
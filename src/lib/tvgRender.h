@@ -34,7 +34,7 @@ struct Surface
     uint32_t cs;
 };
 
-enum RenderUpdateFlag {None = 0, Path = 1, Color = 2, Gradient = 4, Stroke = 8, Transform = 16, All = 32};
+enum RenderUpdateFlag {None = 0, Path = 1, Color = 2, Gradient = 4, Stroke = 8, Transform = 16, StrokeColor = 32, All = 64};
 
 struct RenderTransform
 {
@@ -61,6 +61,12 @@ public:
     virtual bool dispose(TVG_UNUSED const Shape& shape, TVG_UNUSED void *data) { return true; }
     virtual bool preRender() { return true; }
     virtual bool render(TVG_UNUSED const Shape& shape, TVG_UNUSED void *data) { return true; }
+    virtual bool beginComposite(TVG_UNUSED uint8_t opacity) { return true; }
+    virtual bool endComposite() { return true; }
+    virtual bool beginClipPath() { return true; }
+    virtual void* endClipPath(TVG_UNUSED void* data) { return nullptr; }
+    virtual bool popClipPath() { return true; }
+    virtual bool disposeClipPath(TVG_UNUSED void* data) { return true; }
     virtual bool postRender() { return true; }
     virtual bool clear() { return true; }
     virtual bool flush() { return true; }
@@ -57,4 +57,23 @@ Result Scene::reserve(uint32_t size) noexcept
     IMPL->paints.reserve(size);
 
     return Result::Success;
+}
+
+
+Result Scene::opacity(uint8_t o) noexcept
+{
+    if (IMPL->opacity == o) return Result::Success;
+
+    IMPL->opacity = o;
+
+    //Children keep their data, only their regions have to be redrawn
+    Paint::IMPL->flag |= RenderUpdateFlag::Color;
+
+    return Result::Success;
+}
+
+
+uint8_t Scene::opacity() const noexcept
+{
+    return IMPL->opacity;
 }
\ No newline at end of file
@@ -31,6 +31,7 @@
 struct Scene::Impl
 {
     vector<Paint*> paints;
+    uint8_t opacity = 255;
 
     bool dispose(RenderMethod& renderer)
     {
@@ -53,9 +54,19 @@ struct Scene::Impl
 
     bool render(RenderMethod &renderer)
     {
+        if (opacity == 0) return true;
+
+        //Translucent scene is composited as a whole
+        if (opacity < 255) {
+            if (!renderer.beginComposite(opacity)) return false;
+        }
+
         for(auto paint: paints) {
             if(!paint->IMPL->render(renderer)) return false;
         }
+
+        if (opacity < 255) return renderer.endComposite();
+
         return true;
     }
 
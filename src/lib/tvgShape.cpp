@@ -402,4 +402,21 @@ StrokeJoin Shape::strokeJoin() const noexcept
     if (!IMPL->stroke) return StrokeJoin::Bevel;
 
     return IMPL->stroke->join;
-}
\ No newline at end of file
+}
+
+
+Result Shape::antiAlias(bool enable) noexcept
+{
+    if (IMPL->antiAlias == enable) return Result::Success;
+
+    IMPL->antiAlias = enable;
+    IMPL->flag |= (RenderUpdateFlag::Path | RenderUpdateFlag::Stroke);
+
+    return Result::Success;
+}
+
+
+bool Shape::antiAlias() const noexcept
+{
+    return IMPL->antiAlias;
+}
@@ -54,6 +54,7 @@ struct Shape::Impl
     void *edata = nullptr;              //engine data
     Shape *shape = nullptr;
     uint32_t flag = RenderUpdateFlag::None;
+    bool antiAlias = true;
 
     Impl(Shape* s) : path(new ShapePath), shape(s)
     {
@@ -137,7 +138,8 @@ struct Shape::Impl
         stroke->color[2] = b;
         stroke->color[3] = a;
 
-        flag |= RenderUpdateFlag::Stroke;
+        //The stroke geometry is kept
+        flag |= RenderUpdateFlag::StrokeColor;
 
         return true;
     }
@@ -74,6 +74,61 @@ Result SwCanvas::target(uint32_t* buffer, uint32_t stride, uint32_t w, uint32_t
 }
 
 
+uint32_t SwCanvas::damage(const Region** regions) const noexcept
+{
+#ifdef THORVG_SW_RASTER_SUPPORT
+    auto renderer = static_cast<SwRenderer*>(Canvas::pImpl.get()->renderer);
+    if (!renderer) return 0;
+
+    return renderer->damage(regions);
+#endif
+    return 0;
+}
+
+
+Result SwCanvas::trim() noexcept
+{
+#ifdef THORVG_SW_RASTER_SUPPORT
+    //Releases the memory kept for the next updates
+    auto renderer = static_cast<SwRenderer*>(Canvas::pImpl.get()->renderer);
+    if (!renderer) return Result::MemoryCorruption;
+
+    if (!renderer->trim()) return Result::InsufficientCondition;
+
+    return Result::Success;
+#endif
+    return Result::NonSupport;
+}
+
+
+Result SwCanvas::stats(Stats* stats) const noexcept
+{
+#ifdef THORVG_SW_RASTER_SUPPORT
+    if (!stats) return Result::InvalidArguments;
+
+    auto renderer = static_cast<SwRenderer*>(Canvas::pImpl.get()->renderer);
+    if (!renderer) return Result::MemoryCorruption;
+
+    renderer->stats(stats);
+
+    return Result::Success;
+#endif
+    return Result::NonSupport;
+}
+
+
+Result SwCanvas::gradientCache(uint32_t cnt) noexcept
+{
+#ifdef THORVG_SW_RASTER_SUPPORT
+    //The limit applies to the idle color tables of all the canvases
+    if (!SwRenderer::gradientCache(cnt)) return Result::InsufficientCondition;
+
+    return Result::Success;
+#endif
+    return Result::NonSupport;
+}
+
+
 unique_ptr<SwCanvas> SwCanvas::gen() noexcept
 {
 #ifdef THORVG_SW_RASTER_SUPPORT
@@ -19,8 +19,8 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
  * SOFTWARE.
  */
-#include <deque>
 #include <thread>
+#include <atomic>
 #include "tvgCommon.h"
 
 /************************************************************************/
@@ -29,82 +29,153 @@
 
 namespace tvg {
 
-struct TaskQueue {
-    deque<Task*>             taskDeque;
-    mutex                    mtx;
-    condition_variable       ready;
-    bool                     done = false;
+//Chase-Lev deque of a worker: the owner pushes and pops at the bottom, the others steal from the top
+struct TaskDeque {
+    static constexpr int64_t CAPACITY = 1024;    //power of 2
 
-    bool tryPop(Task** task)
+    atomic<int64_t>          top{0};
+    atomic<Task*>            tasks[CAPACITY];
+    atomic<int64_t>          bottom{0};
+
+    //Owner only
+    bool push(Task* task)
     {
-        unique_lock<mutex> lock{mtx, try_to_lock};
-        if (!lock || taskDeque.empty()) return false;
-        *task = taskDeque.front();
-        taskDeque.pop_front();
+        auto b = bottom.load(memory_order_relaxed);
+        auto t = top.load(memory_order_acquire);
+        if (b - t >= CAPACITY) return false;
+
+        tasks[b & (CAPACITY - 1)].store(task, memory_order_relaxed);
+        bottom.store(b + 1, memory_order_release);
 
         return true;
     }
 
-    bool tryPush(Task* task)
+    //Owner only, the last task is raced with the thieves
+    bool pop(Task** task)
     {
-        {
-            unique_lock<mutex> lock{mtx, try_to_lock};
-            if (!lock) return false;
-            taskDeque.push_back(task);
+        auto b = bottom.load(memory_order_relaxed) - 1;
+        bottom.store(b, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        auto t = top.load(memory_order_relaxed);
+
+        if (t > b) {
+            bottom.store(b + 1, memory_order_relaxed);
+            return false;
         }
 
-        ready.notify_one();
+        *task = tasks[b & (CAPACITY - 1)].load(memory_order_relaxed);
 
+        if (t == b) {
+            auto won = top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+            bottom.store(b + 1, memory_order_relaxed);
+            return won;
+        }
         return true;
     }
 
-    void complete()
+    //Any thread
+    bool steal(Task** task)
     {
-        {
-            unique_lock<mutex> lock{mtx};
-            done = true;
-        }
-        ready.notify_all();
+        auto t = top.load(memory_order_acquire);
+        atomic_thread_fence(memory_order_seq_cst);
+        auto b = bottom.load(memory_order_acquire);
+
+        if (t >= b) return false;
+
+        auto candidate = tasks[t & (CAPACITY - 1)].load(memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed)) return false;
+
+        *task = candidate;
+
+        return true;
     }
+};
 
-    bool pop(Task** task)
-    {
-        unique_lock<mutex> lock{mtx};
 
-        while (taskDeque.empty() && !done) {
-            ready.wait(lock);
-        }
+//Bounded queue of the tasks requested out of the workers, any thread can push and pop
+struct TaskInbox {
+    static constexpr size_t CAPACITY = 4096;    //power of 2
 
-        if (taskDeque.empty()) return false;
+    struct Cell {
+        atomic<size_t>       seq;
+        Task*                task;
+    };
 
-        *task = taskDeque.front();
-        taskDeque.pop_front();
+    Cell                     cells[CAPACITY];
+    atomic<size_t>           head{0};
+    atomic<size_t>           tail{0};
 
-        return true;
+    TaskInbox()
+    {
+        for (size_t i = 0; i < CAPACITY; ++i) cells[i].seq.store(i, memory_order_relaxed);
     }
 
-    void push(Task* task)
+    bool push(Task* task)
     {
-        {
-            unique_lock<mutex> lock{mtx};
-            taskDeque.push_back(task);
-        }
+        auto pos = tail.load(memory_order_relaxed);
 
-        ready.notify_one();
+        while (true) {
+            auto& cell = cells[pos & (CAPACITY - 1)];
+            auto diff = static_cast<intptr_t>(cell.seq.load(memory_order_acquire)) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    cell.task = task;
+                    cell.seq.store(pos + 1, memory_order_release);
+                    return true;
+                }
+            //Full
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(memory_order_relaxed);
+            }
+        }
     }
 
+    bool pop(Task** task)
+    {
+        auto pos = head.load(memory_order_relaxed);
+
+        while (true) {
+            auto& cell = cells[pos & (CAPACITY - 1)];
+            auto diff = static_cast<intptr_t>(cell.seq.load(memory_order_acquire)) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    *task = cell.task;
+                    cell.seq.store(pos + CAPACITY, memory_order_release);
+                    return true;
+                }
+            //Empty
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = head.load(memory_order_relaxed);
+            }
+        }
+    }
 };
 
 
+//The deque of the calling thread, null out of the workers
+static thread_local TaskDeque* workerDeque = nullptr;
+
+
 class TaskSchedulerImpl
 {
 public:
     unsigned                       threadCnt;
     vector<thread>                 threads;
-    vector<TaskQueue>              taskQueues;
-    atomic<unsigned>               idx{0};
+    vector<TaskDeque>              taskDeques;
+    TaskInbox                      inbox;
 
-    TaskSchedulerImpl(unsigned threadCnt) : threadCnt(threadCnt), taskQueues(threadCnt)
+    //Parking of the idle workers. The pushers take the mutex only if someone sleeps
+    mutex                          mtx;
+    condition_variable             ready;
+    atomic<unsigned>               sleepers{0};
+    atomic<unsigned>               epoch{0};
+    atomic<bool>                   done{false};
+
+    TaskSchedulerImpl(unsigned threadCnt) : threadCnt(threadCnt), taskDeques(threadCnt)
     {
         for (unsigned i = 0; i < threadCnt; ++i) {
             threads.emplace_back([&, i] { run(i); });
@@ -113,27 +184,86 @@ public:
 
     ~TaskSchedulerImpl()
     {
-        for (auto& queue : taskQueues) queue.complete();
+        done.store(true);
+        {
+            unique_lock<mutex> lock{mtx};
+            ++epoch;
+        }
+        ready.notify_all();
+
         for (auto& thread : threads) thread.join();
     }
 
+    //Own tasks first, then the requested ones, then the others' from a random victim on
+    bool find(unsigned i, uint32_t& seed, Task** task)
+    {
+        if (taskDeques[i].pop(task)) return true;
+        if (inbox.pop(task)) return true;
+
+        //xorshift
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+
+        auto victim = seed % threadCnt;
+        for (unsigned n = 0; n < threadCnt; ++n, ++victim) {
+            if (victim == threadCnt) victim = 0;
+            if (victim == i) continue;
+            if (taskDeques[victim].steal(task)) return true;
+        }
+        return false;
+    }
+
     void run(unsigned i)
     {
+        constexpr auto SPIN_CNT = 32;
+
+        workerDeque = &taskDeques[i];
+        uint32_t seed = i * 2654435761u + 1;
         Task* task;
 
         //Thread Loop
         while (true) {
             auto success = false;
-            for (unsigned i = 0; i < threadCnt * 2; ++i) {
-                if (taskQueues[(i + i) % threadCnt].tryPop(&task)) {
+            for (auto spin = 0; spin < SPIN_CNT && !success; ++spin) {
+                if (find(i, seed, &task)) success = true;
+                else this_thread::yield();
+            }
+
+            if (!success) {
+                //Announce the sleep, then look again: a push either sees the sleeper or is seen here
+                auto cur = epoch.load();
+                sleepers.fetch_add(1);
+                atomic_thread_fence(memory_order_seq_cst);
+
+                if (find(i, seed, &task)) {
                     success = true;
-                    break;
+                } else if (!done.load()) {
+                    unique_lock<mutex> lock{mtx};
+                    while (epoch.load() == cur && !done.load()) ready.wait(lock);
                 }
-            }
+                sleepers.fetch_sub(1);
 
-            if (!success && !taskQueues[i].pop(&task)) break;
+                if (!success) {
+                    if (!done.load()) continue;
+                    //Leftovers are run before quitting
+                    if (!find(i, seed, &task)) break;
+                }
+            }
             (*task)();
         }
+        workerDeque = nullptr;
+    }
+
+    void wake()
+    {
+        atomic_thread_fence(memory_order_seq_cst);
+        if (sleepers.load() == 0) return;
+        {
+            unique_lock<mutex> lock{mtx};
+            ++epoch;
+        }
+        ready.notify_one();
     }
 
     void request(Task* task)
@@ -141,11 +271,12 @@ public:
         //Async
         if (threadCnt > 0) {
             task->prepare();
-            auto i = idx++;
-            for (unsigned n = 0; n < threadCnt; ++n) {
-                if (taskQueues[(i + n) % threadCnt].tryPush(task)) return;
+            //Nowhere to keep it, the requester runs it
+            if (!(workerDeque && workerDeque->push(task)) && !inbox.push(task)) {
+                (*task)();
+                return;
             }
-            taskQueues[i % threadCnt].push(task);
+            wake();
         //Sync
         } else {
             task->run();
@@ -182,3 +313,10 @@ void TaskScheduler::request(Task* task)
         inst->request(task);
     }
 }
+
+
+unsigned TaskScheduler::threads()
+{
+    if (inst) return inst->threadCnt;
+    return 0;
+}
@@ -48,6 +48,13 @@ public:
         return receiver.valid();
     }
 
+    //Has the task finished? (get() won't block)
+    bool ready()
+    {
+        if (!receiver.valid()) return true;
+        return receiver.wait_for(chrono::seconds(0)) == future_status::ready;
+    }
+
 protected:
     virtual void run() = 0;
 
@@ -72,6 +79,7 @@ struct TaskScheduler
     static void init(unsigned threads);
     static void term();
     static void request(Task* task);
+    static unsigned threads();
 };
 
 }
@@ -857,6 +857,18 @@ static void _handleDisplayAttr(TVG_UNUSED SvgLoaderData* loader, SvgNode* node,
 }
 
 
+static void _handleClipPathAttr(TVG_UNUSED SvgLoaderData* loader, SvgNode* node, const char* value)
+{
+    //Only the reference to a <clipPath> is supported
+    if (strncmp(value, "url", 3)) return;
+
+    auto comp = &node->style->comp;
+    delete comp->url;
+    comp->url = _idFromUrl(value + 3);
+    comp->method = CompositeMethod::ClipPath;
+}
+
+
 typedef void (*styleMethod)(SvgLoaderData* loader, SvgNode* node, const char* value);
 
 
@@ -884,7 +896,8 @@ static constexpr struct
     STYLE_DEF(stroke-opacity, StrokeOpacity),
     STYLE_DEF(stroke-dasharray, StrokeDashArray),
     STYLE_DEF(transform, Transform),
-    STYLE_DEF(display, Display)
+    STYLE_DEF(display, Display),
+    STYLE_DEF(clip-path, ClipPath)
 };
 
 
@@ -1018,6 +1031,9 @@ static SvgNode* _createClipPathNode(SvgLoaderData* loader, SvgNode* parent, cons
 
     loader->svgParse->node->display = false;
 
+    //The id to be referred and the transform
+    simpleXmlParseAttributes(buf, bufLength, _attrParseGNode, loader);
+
     return loader->svgParse->node;
 }
 
@@ -1443,6 +1459,19 @@ static void _copyAttr(SvgNode* to, SvgNode* from)
     //Copy style attribute;
     memcpy(to->style, from->style, sizeof(SvgStyleProperty));
 
+    //The owned members of the style must not be shared with the source
+    if (from->style->fill.paint.url) to->style->fill.paint.url = new string(*from->style->fill.paint.url);
+    if (from->style->stroke.paint.url) to->style->stroke.paint.url = new string(*from->style->stroke.paint.url);
+    if (from->style->comp.url) to->style->comp.url = new string(*from->style->comp.url);
+    //Resolved again from the urls when the document is closed
+    to->style->fill.paint.gradient = nullptr;
+    to->style->stroke.paint.gradient = nullptr;
+    to->style->comp.node = nullptr;
+    to->style->stroke.dash.array = {};
+    for (uint32_t i = 0; i < from->style->stroke.dash.array.cnt; ++i) {
+        to->style->stroke.dash.array.push(from->style->stroke.dash.array.list[i]);
+    }
+
     //Copy node attribute
     switch (from->type) {
         case SvgNodeType::Circle: {
@@ -2195,6 +2224,36 @@ static void _updateGradient(SvgNode* node, SvgVector<SvgStyleGradient*>* gradide
     }
 }
 
+static SvgNode* _findNodeById(SvgNode* node, const char* id)
+{
+    if (!node) return nullptr;
+
+    if (node->id && !strcmp(node->id->c_str(), id)) return node;
+
+    auto child = node->child.list;
+    for (uint32_t i = 0; i < node->child.cnt; ++i, ++child) {
+        auto found = _findNodeById(*child, id);
+        if (found) return found;
+    }
+    return nullptr;
+}
+
+
+static void _updateComposite(SvgNode* node, SvgNode* root)
+{
+    auto comp = &node->style->comp;
+    if (comp->url && !comp->node) {
+        comp->node = _findNodeById(root, comp->url->c_str());
+        if (!comp->node) comp->node = _findNodeById(root->node.doc.defs, comp->url->c_str());
+    }
+
+    auto child = node->child.list;
+    for (uint32_t i = 0; i < node->child.cnt; ++i, ++child) {
+        _updateComposite(*child, root);
+    }
+}
+
+
 static void _freeGradientStyle(SvgStyleGradient* grad)
 {
     if (!grad) return;
@@ -2222,6 +2281,7 @@ static void _freeNodeStyle(SvgStyleProperty* style)
     _freeGradientStyle(style->stroke.paint.gradient);
     if (style->stroke.dash.array.cnt > 0) style->stroke.dash.array.clear();
     delete style->stroke.paint.url;
+    delete style->comp.url;
     free(style);
 }
 
@@ -2357,6 +2417,8 @@ void SvgLoader::run()
         if (defs) _updateGradient(loaderData.doc, &defs->node.defs.gradients);
 
         if (loaderData.gradients.cnt > 0) _updateGradient(loaderData.doc, &loaderData.gradients);
+
+        _updateComposite(loaderData.doc, loaderData.doc);
     }
     root = builder.build(loaderData.doc);
 };
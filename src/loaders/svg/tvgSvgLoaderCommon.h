@@ -297,10 +297,18 @@ struct SvgStyleStroke
     int dashCount;
 };
 
+struct SvgComposite
+{
+    CompositeMethod method;     //only clip-path is parsed, masks are ignored
+    string *url;
+    SvgNode* node;
+};
+
 struct SvgStyleProperty
 {
     SvgStyleFill fill;
     SvgStyleStroke stroke;
+    SvgComposite comp;
     int opacity;
     uint8_t r;
     uint8_t g;
@@ -307,23 +307,54 @@ unique_ptr<Shape> _shapeBuildHelper(SvgNode* node, float vx, float vy, float vw,
 }
 
 
-unique_ptr<Scene> _sceneBuildHelper(SvgNode* node, float vx, float vy, float vw, float vh, int parentOpacity)
+//The shapes of a clip path, their paints and clip paths don't matter
+unique_ptr<Scene> _clipPathBuildHelper(SvgNode* node, float vx, float vy, float vw, float vh)
+{
+    auto scene = Scene::gen();
+    if (node->transform) scene->transform(*node->transform);
+
+    auto child = node->child.list;
+    for (uint32_t i = 0; i < node->child.cnt; ++i, ++child) {
+        if (!(*child)->display) continue;
+        if ((*child)->type == SvgNodeType::G) {
+            scene->push(_clipPathBuildHelper(*child, vx, vy, vw, vh));
+        } else {
+            scene->push(_shapeBuildHelper(*child, vx, vy, vw, vh));
+        }
+    }
+    return scene;
+}
+
+
+void _applyComposition(Paint* paint, const SvgNode* node, float vx, float vy, float vw, float vh)
+{
+    auto comp = &node->style->comp;
+    if (comp->method != CompositeMethod::ClipPath || !comp->node) return;
+
+    paint->composite(_clipPathBuildHelper(comp->node, vx, vy, vw, vh), CompositeMethod::ClipPath);
+}
+
+
+unique_ptr<Scene> _sceneBuildHelper(SvgNode* node, float vx, float vy, float vw, float vh)
 {
     if (node->type == SvgNodeType::Doc || node->type == SvgNodeType::G) {
         auto scene = Scene::gen();
         if (node->transform) scene->transform(*node->transform);
-        node->style->opacity = (node->style->opacity * parentOpacity) / 255.0f;
+        //Group opacity applies to the composited children, not to each of them
+        scene->opacity(node->style->opacity);
         if (node->display) {
             auto child = node->child.list;
             for (uint32_t i = 0; i < node->child.cnt; ++i, ++child) {
                 if ((*child)->type == SvgNodeType::Doc || (*child)->type == SvgNodeType::G) {
-                    scene->push(_sceneBuildHelper(*child, vx, vy, vw, vh, node->style->opacity));
+                    scene->push(_sceneBuildHelper(*child, vx, vy, vw, vh));
                 } else {
-                    (*child)->style->opacity = ((*child)->style->opacity * node->style->opacity) / 255.0f;
-                    scene->push(_shapeBuildHelper(*child, vx, vy, vw, vh));
+                    auto shape = _shapeBuildHelper(*child, vx, vy, vw, vh);
+                    _applyComposition(shape.get(), *child, vx, vy, vw, vh);
+                    scene->push(move(shape));
                 }
             }
         }
+        _applyComposition(scene.get(), node, vx, vy, vw, vh);
         return scene;
     }
     return nullptr;
@@ -349,5 +380,5 @@ unique_ptr<Scene> SvgSceneBuilder::build(SvgNode* node)
     viewBox.w = node->node.doc.vw;
     viewBox.h = node->node.doc.vh;
     preserveAspect = node->node.doc.preserveAspect;
-    return _sceneBuildHelper(node, viewBox.x, viewBox.y, viewBox.w, viewBox.h, 255);
+    return _sceneBuildHelper(node, viewBox.x, viewBox.y, viewBox.w, viewBox.h);
 }
@@ -0,0 +1,185 @@
+#include "testCommon.h"
+
+/************************************************************************/
+/* Drawing Commands                                                     */
+/************************************************************************/
+
+//A clipped rect, drawn through <use>
+static const char* svg = "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\" viewBox=\"0 0 100 100\"><defs><clipPath id=\"c\"><circle cx=\"50\" cy=\"50\" r=\"40\"/></clipPath><rect id=\"r\" x=\"10\" y=\"10\" width=\"80\" height=\"40\" fill=\"#ff00ff\" clip-path=\"url(#c)\"/></defs><use xlink:href=\"#r\"/></svg>";
+
+
+void tvgDrawCmds(tvg::Canvas* canvas)
+{
+    if (!canvas) return;
+
+    canvas->reserve(4);
+
+    //Background
+    auto shape1 = tvg::Shape::gen();
+    shape1->appendRect(0, 0, WIDTH, HEIGHT, 0, 0);
+    shape1->fill(255, 255, 255, 255);
+    if (canvas->push(move(shape1)) != tvg::Result::Success) return;
+
+    //Prepare Star
+    auto shape2 = tvg::Shape::gen();
+    shape2->moveTo(199, 34);
+    shape2->lineTo(253, 143);
+    shape2->lineTo(374, 160);
+    shape2->lineTo(287, 244);
+    shape2->lineTo(307, 365);
+    shape2->lineTo(199, 309);
+    shape2->lineTo(97, 365);
+    shape2->lineTo(112, 245);
+    shape2->lineTo(26, 161);
+    shape2->lineTo(146, 143);
+    shape2->close();
+    shape2->fill(0, 0, 255, 255);
+    shape2->stroke(10);
+    shape2->stroke(255, 255, 0, 255);
+
+    //Clip the star with a circle
+    auto clip1 = tvg::Shape::gen();
+    clip1->appendCircle(200, 230, 110, 110);
+    shape2->composite(move(clip1), tvg::CompositeMethod::ClipPath);
+    if (canvas->push(move(shape2)) != tvg::Result::Success) return;
+
+    //Prepare Scene
+    auto scene = tvg::Scene::gen();
+    scene->reserve(2);
+
+    auto shape3 = tvg::Shape::gen();
+    shape3->appendCircle(550, 550, 150, 150);
+    shape3->fill(255, 0, 0, 255);
+    scene->push(move(shape3));
+
+    auto shape4 = tvg::Shape::gen();
+    shape4->appendRect(450, 450, 300, 300, 50, 50);
+    shape4->fill(0, 255, 0, 170);
+    scene->push(move(shape4));
+
+    //Clip the whole scene with the union of two stripes
+    auto clip2 = tvg::Scene::gen();
+    auto stripe1 = tvg::Shape::gen();
+    stripe1->appendRect(400, 480, 400, 60, 0, 0);
+    clip2->push(move(stripe1));
+    auto stripe2 = tvg::Shape::gen();
+    stripe2->appendRect(520, 400, 60, 400, 0, 0);
+    clip2->push(move(stripe2));
+    scene->composite(move(clip2), tvg::CompositeMethod::ClipPath);
+
+    if (canvas->push(move(scene)) != tvg::Result::Success) return;
+
+    //Clip path of a svg element referred by <use>
+    auto picture = tvg::Picture::gen();
+    if (picture->load(svg, strlen(svg)) != tvg::Result::Success) return;
+    picture->scale(3);
+    picture->translate(450, 30);
+
+    if (canvas->push(move(picture)) != tvg::Result::Success) return;
+}
+
+
+/************************************************************************/
+/* Sw Engine Test Code                                                  */
+/************************************************************************/
+
+static unique_ptr<tvg::SwCanvas> swCanvas;
+
+void tvgSwTest(uint32_t* buffer)
+{
+    //Create a Canvas
+    swCanvas = tvg::SwCanvas::gen();
+    swCanvas->target(buffer, WIDTH, WIDTH, HEIGHT, tvg::SwCanvas::ARGB8888);
+
+    /* Push the shape into the Canvas drawing list
+       When this shape is into the canvas list, the shape could update & prepare
+       internal data asynchronously for coming rendering.
+       Canvas keeps this shape node unless user call canvas->clear() */
+    tvgDrawCmds(swCanvas.get());
+}
+
+void drawSwView(void* data, Eo* obj)
+{
+    if (swCanvas->draw() == tvg::Result::Success) {
+        swCanvas->sync();
+    }
+}
+
+
+/************************************************************************/
+/* GL Engine Test Code                                                  */
+/************************************************************************/
+
+static unique_ptr<tvg::GlCanvas> glCanvas;
+
+void initGLview(Evas_Object *obj)
+{
+    static constexpr auto BPP = 4;
+
+    //Create a Canvas
+    glCanvas = tvg::GlCanvas::gen();
+    glCanvas->target(nullptr, WIDTH * BPP, WIDTH, HEIGHT);
+
+    /* Push the shape into the Canvas drawing list
+       When this shape is into the canvas list, the shape could update & prepare
+       internal data asynchronously for coming rendering.
+       Canvas keeps this shape node unless user call canvas->clear() */
+    tvgDrawCmds(glCanvas.get());
+}
+
+void drawGLview(Evas_Object *obj)
+{
+    auto gl = elm_glview_gl_api_get(obj);
+    gl->glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    gl->glClear(GL_COLOR_BUFFER_BIT);
+
+    if (glCanvas->draw() == tvg::Result::Success) {
+        glCanvas->sync();
+    }
+}
+
+
+/************************************************************************/
+/* Main Code                                                            */
+/************************************************************************/
+
+int main(int argc, char **argv)
+{
+    tvg::CanvasEngine tvgEngine = tvg::CanvasEngine::Sw;
+
+    if (argc > 1) {
+        if (!strcmp(argv[1], "gl")) tvgEngine = tvg::CanvasEngine::Gl;
+    }
+
+    //Initialize ThorVG Engine
+    if (tvgEngine == tvg::CanvasEngine::Sw) {
+        cout << "tvg engine: software" << endl;
+    } else {
+        cout << "tvg engine: opengl" << endl;
+    }
+
+    //Threads Count
+    auto threads = std::thread::hardware_concurrency();
+
+    //Initialize ThorVG Engine
+    if (tvg::Initializer::init(tvgEngine, threads) == tvg::Result::Success) {
+
+        elm_init(argc, argv);
+
+        if (tvgEngine == tvg::CanvasEngine::Sw) {
+            createSwView();
+        } else {
+            createGlView();
+        }
+
+        elm_run();
+        elm_shutdown();
+
+        //Terminate ThorVG Engine
+        tvg::Initializer::term(tvgEngine);
+
+    } else {
+        cout << "engine is not supported" << endl;
+    }
+    return 0;
+}
@@ -101,6 +101,29 @@ void tvgDrawCmds(tvg::Canvas* canvas)
     float dashPattern3[2] = {10, 10};
     shape6->stroke(dashPattern3, 2);
     if (canvas->push(move(shape6)) != tvg::Result::Success) return;
+
+    //Zero-length dashes: dots of the caps
+    auto shape7 = tvg::Shape::gen();
+    shape7->moveTo(20, 785);
+    shape7->lineTo(380, 785);
+    shape7->stroke(255, 255, 255, 255);
+    shape7->stroke(6);
+    shape7->stroke(tvg::StrokeCap::Round);
+
+    float dashPattern4[2] = {0, 15};
+    shape7->stroke(dashPattern4, 2);
+    if (canvas->push(move(shape7)) != tvg::Result::Success) return;
+
+    auto shape8 = tvg::Shape::gen();
+    shape8->moveTo(420, 785);
+    shape8->cubicTo(520, 765, 680, 805, 780, 785);
+    shape8->stroke(255, 255, 255, 255);
+    shape8->stroke(6);
+    shape8->stroke(tvg::StrokeCap::Square);
+
+    float dashPattern5[2] = {0, 15};
+    shape8->stroke(dashPattern5, 2);
+    if (canvas->push(move(shape8)) != tvg::Result::Success) return;
 }
 
 